@@ -0,0 +1,123 @@
+#ifndef AST_ARENA_HPP_
+#define AST_ARENA_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+
+// Contiguous run of elements living in an Arena.
+template <class T>
+class Span
+{
+public:
+    Span() = default;
+    Span(T *data_, unsigned size_) : items(data_), count(size_) {}
+
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    unsigned size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](unsigned idx) const { return items[idx]; }
+    T& front() const { return items[0]; }
+
+private:
+    T *items = nullptr;
+    unsigned count = 0;
+};
+
+// Bump allocator for the nodes of a Program. Nodes are carved out of big
+// chunks and all of them go away together with the arena, in reverse order
+// of creation; they never delete each other.
+class Arena
+{
+public:
+    static constexpr std::size_t chunkSize = 32 * 1024;
+
+    Arena() = default;
+    Arena(const Arena &) = delete;
+    const Arena &operator=(const Arena &) = delete;
+
+    ~Arena() {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->destroy(it->object);
+    }
+
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        T *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            destructors.push_back({object, [](void *ptr) { static_cast<T*>(ptr)->~T(); }});
+        return object;
+    }
+
+    // children of a node, collected by the parser before the node is built
+    template <class T>
+    Span<T> copy(const std::vector<T> &items) {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                      "Span elements are copied as raw memory");
+        if (items.empty())
+            return Span<T>();
+        T *data = static_cast<T*>(allocate(items.size() * sizeof(T), alignof(T)));
+        std::memcpy(data, items.data(), items.size() * sizeof(T));
+        return Span<T>(data, items.size());
+    }
+
+    // bytes of the chunks the arena holds
+    std::size_t reserved() const { return bytes; }
+
+    // takes over the nodes of another arena, which is left empty
+    void merge(Arena &&other) {
+        std::lock_guard<std::mutex> lock(merging);
+        for (auto &chunk : other.chunks)
+            chunks.push_back(std::move(chunk));
+        bytes += other.bytes;
+        other.bytes = 0;
+        destructors.insert(destructors.end(), other.destructors.begin(), other.destructors.end());
+        other.chunks.clear();
+        other.destructors.clear();
+        other.cur = other.end = nullptr;
+    }
+
+private:
+    struct Destructor {
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    void* allocate(std::size_t size, std::size_t align) {
+        std::size_t pad = (align - reinterpret_cast<std::size_t>(cur) % align) % align;
+        if (cur == nullptr || size + pad > static_cast<std::size_t>(end - cur)) {
+            // oversized requests get a chunk of their own
+            std::size_t length = std::max(chunkSize, size + align);
+            chunks.emplace_back(new char[length]);
+            bytes += length;
+            cur = chunks.back().get();
+            end = cur + length;
+            pad = (align - reinterpret_cast<std::size_t>(cur) % align) % align;
+        }
+        char *mem = cur + pad;
+        cur = mem + size;
+        return mem;
+    }
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::vector<Destructor> destructors;
+    char *cur = nullptr;
+    char *end = nullptr;
+    std::size_t bytes = 0;
+    std::mutex merging;
+};
+
+}
+
+#endif
@@ -0,0 +1,37 @@
+#include "Budget.hpp"
+
+#include <stdexcept>
+
+using namespace ast;
+
+void Budget::start() {
+    used = 0;
+    sinceYield = 0;
+    deadline = std::chrono::steady_clock::now() + timeout;
+    refill();
+}
+
+void Budget::check() {
+    used += slice;
+    if (maxSteps != 0 && used > maxSteps)
+        throw std::runtime_error("Step limit exceeded");
+    if (timeout.count() != 0 && std::chrono::steady_clock::now() > deadline)
+        throw std::runtime_error("Time out");
+    if (yieldSteps != 0 && yield) {
+        sinceYield += slice;
+        if (sinceYield >= yieldSteps) {
+            sinceYield = 0;
+            yield();
+        }
+    }
+    refill();
+}
+
+void Budget::refill() {
+    slice = checkInterval;
+    if (yieldSteps != 0 && yieldSteps < slice)
+        slice = yieldSteps;
+    if (maxSteps != 0 && maxSteps - used < slice)
+        slice = static_cast<unsigned>(maxSteps - used) + 1;
+    countdown = slice;
+}
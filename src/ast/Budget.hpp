@@ -0,0 +1,75 @@
+#ifndef AST_BUDGET_HPP_
+#define AST_BUDGET_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace ast
+{
+
+// Limits of a single run, shared by every loop and call in it. A step is
+// one loop iteration or one call of a script function; the timeout counts
+// from start(). 0 leaves a limit off. Both limits are looked at only every
+// checkInterval steps, so a step costs a decrement and a branch, and a run
+// going over either throws.
+//
+// A run can also be made to yield, handing the thread back to whoever
+// resumes it, see engine::Task. The timeout keeps counting while it waits.
+//
+// Native code can't be stopped half way, so a run with any limit, or one
+// that yields, doesn't use the JIT.
+class Budget
+{
+public:
+    static const unsigned checkInterval = 4096;
+
+    Budget() = default;
+    Budget(std::uint64_t maxSteps_, std::chrono::milliseconds timeout_)
+        : maxSteps(maxSteps_), timeout(timeout_) {}
+
+    bool limited() const { return maxSteps != 0 || timeout.count() != 0 || yield; }
+
+    // yield is called about every steps steps (all of them checkInterval
+    // at most) and at pause(), from deep inside the run; it returns when
+    // the run is to go on. 0 steps yields only at pause().
+    void yieldEvery(unsigned steps, std::function<void()> yield_) {
+        yieldSteps = steps;
+        yield = std::move(yield_);
+    }
+
+    // before a builtin that blocks, e.g. on a file
+    void pause() {
+        if (yield)
+            yield();
+    }
+
+    // the steps and the clock start over
+    void start();
+
+    void step() {
+        if (--countdown == 0)
+            check();
+    }
+
+private:
+    void check();
+    // steps to take before the next check, which then sees the step limit
+    // right as it's passed
+    void refill();
+
+    std::uint64_t maxSteps = 0;
+    std::chrono::milliseconds timeout{0};
+    unsigned yieldSteps = 0;
+    std::function<void()> yield;
+
+    std::uint64_t used = 0;
+    std::uint64_t sinceYield = 0;
+    unsigned slice = checkInterval;
+    unsigned countdown = checkInterval;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef AST_BUILTIN_HPP_
+#define AST_BUILTIN_HPP_
+
+#include "Var.hpp"
+
+namespace ast
+{
+
+// function implemented in C++ that scripts call like any other function;
+// args points at arity values the builtin is free to move from. Builtins
+// are plain constant data, so a library of them is a static table.
+struct Builtin {
+    typedef Var (*Native)(Var *args);
+
+    const char *name;
+    unsigned arity;
+    Native native;
+    // the result depends on the arguments alone and calling it changes
+    // nothing else, so a loop may compute it once, see Optimizer
+    bool pure = false;
+    // waits on something outside the script, like a file; a run that
+    // yields does so before calling it, see Budget::pause()
+    bool blocking = false;
+};
+
+}
+
+#endif
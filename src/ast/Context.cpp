@@ -0,0 +1,51 @@
+#include "Context.hpp"
+
+#include <new>
+
+using namespace ast;
+
+Context::~Context() {
+    for (auto &block : blocks)
+        ::operator delete(block.data);
+}
+
+Var* Context::allocate(unsigned size) {
+    if (size == 0)
+        return nullptr;
+
+    while (blocks.empty() || blocks[current].used + size > blocks[current].capacity) {
+        if (!blocks.empty() && blocks[current].used > 0)
+            ++current;
+
+        if (current == blocks.size()) {
+            size_t capacity = size > blockSize ? size : blockSize;
+            blocks.push_back(Block{static_cast<Var*>(::operator new(capacity * sizeof(Var))), capacity, 0});
+        } else if (blocks[current].capacity < size) {
+            // an empty block too small for this frame gets replaced
+            ::operator delete(blocks[current].data);
+            blocks[current].data = static_cast<Var*>(::operator new(size * sizeof(Var)));
+            blocks[current].capacity = size;
+        }
+    }
+
+    Block &block = blocks[current];
+    Var* slots = block.data + block.used;
+    for (unsigned i = 0; i < size; ++i)
+        new (slots + i) Var();
+    block.used += size;
+
+    return slots;
+}
+
+void Context::release(Var* slots, unsigned size) {
+    if (size == 0)
+        return;
+
+    for (unsigned i = 0; i < size; ++i)
+        slots[i].~Var();
+
+    Block &block = blocks[current];
+    block.used -= size;
+    if (block.used == 0 && current > 0)
+        --current;
+}
@@ -0,0 +1,62 @@
+#ifndef AST_CONTEXT_HPP_
+#define AST_CONTEXT_HPP_
+
+#include <cstddef>
+#include <vector>
+#include "Var.hpp"
+#include "Budget.hpp"
+#include "Profiler.hpp"
+
+namespace ast
+{
+
+// Execution state of a single run. Frames of nested calls are carved out
+// of large arena blocks in LIFO order, so a call costs one bump of the
+// arena and no heap allocation once the blocks are warmed up.
+class Context
+{
+public:
+    Context() = default;
+    ~Context();
+
+    Context(const Context&) = delete;
+    Context& operator=(const Context&) = delete;
+
+    Var* allocate(unsigned size);
+    void release(Var* slots, unsigned size);
+
+    // hot functions run as native code, see FunctionDefinition::runNative()
+    void enableJit(bool enable) { jit = enable; }
+    bool jitEnabled() const { return jit && !limits.limited() && profiling == nullptr; }
+
+    // limits of the run, started by setBudget()
+    void setBudget(const Budget &budget) {
+        limits = budget;
+        limits.start();
+    }
+    Budget& budget() { return limits; }
+
+    // null unless the run is profiled; natively run calls couldn't be, so
+    // a profiled run doesn't use the JIT
+    void setProfiler(Profiler *profiler) { profiling = profiler; }
+    Profiler* profiler() { return profiling; }
+
+private:
+    struct Block {
+        Var* data;
+        size_t capacity;
+        size_t used;
+    };
+
+    static const size_t blockSize = 4096;
+
+    std::vector<Block> blocks;
+    size_t current = 0;
+    bool jit = false;
+    Budget limits;
+    Profiler *profiling = nullptr;
+};
+
+}
+
+#endif
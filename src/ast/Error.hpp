@@ -0,0 +1,55 @@
+#ifndef AST_ERROR_HPP_
+#define AST_ERROR_HPP_
+
+#include <stdexcept>
+#include <string>
+
+namespace ast
+{
+
+// Error of a running script, with the source line and the function it
+// happened in. Operators and builtins throw a plain std::runtime_error;
+// the statement or instruction it leaves first adds where that was, which
+// costs nothing until something is thrown.
+class RuntimeError : public std::runtime_error
+{
+public:
+    RuntimeError(const std::string &message_, int line_, const std::string &function_ = std::string())
+        : std::runtime_error(describe(message_, line_, function_)),
+          msg(message_), ln(line_), fn(function_) {}
+
+    const std::string& message() const { return msg; }
+    int line() const { return ln; }
+    // empty until the call it happened in is known
+    const std::string& function() const { return fn; }
+
+    // the error being handled, with line and function unless it has them
+    [[noreturn]] static void rethrow(int line, const std::string &function = std::string()) {
+        try {
+            throw;
+        } catch (RuntimeError &e) {
+            if (!e.function().empty() || function.empty())
+                throw;
+            throw RuntimeError(e.message(), e.line(), function);
+        } catch (std::runtime_error &e) {
+            throw RuntimeError(e.what(), line, function);
+        }
+    }
+
+private:
+    // e.g. "line 12 in sum: Index out of range"
+    static std::string describe(const std::string &message, int line, const std::string &function) {
+        std::string where = "line " + std::to_string(line);
+        if (!function.empty())
+            where += " in " + function;
+        return where + ": " + message;
+    }
+
+    std::string msg;
+    int ln;
+    std::string fn;
+};
+
+}
+
+#endif
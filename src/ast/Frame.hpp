@@ -0,0 +1,39 @@
+#ifndef AST_FRAME_HPP_
+#define AST_FRAME_HPP_
+
+#include "Var.hpp"
+#include "Context.hpp"
+
+namespace ast
+{
+
+// position of a variable in the frame of its function, resolved by the parser
+struct Slot {
+    unsigned index;
+};
+
+// variables of a single function invocation, living on the Context's stack
+// for as long as the call lasts
+class Frame
+{
+public:
+    Frame(Context &context_, unsigned size_)
+        : ctx(context_), slots(context_.allocate(size_)), size(size_) {}
+
+    ~Frame() { ctx.release(slots, size); }
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    Var& operator[](Slot slot) { return slots[slot.index]; }
+    Context& context() { return ctx; }
+
+private:
+    Context &ctx;
+    Var* slots;
+    unsigned size;
+};
+
+}
+
+#endif
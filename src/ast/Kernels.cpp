@@ -0,0 +1,371 @@
+#include "Kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+using namespace ast;
+
+namespace
+{
+
+// Arithmetic wraps around like the vector units do, instead of being
+// undefined on overflow. That includes INT_MIN / -1.
+
+inline possibleValue wrap(unsigned val) {
+    return static_cast<possibleValue>(val);
+}
+
+void addScalar(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = wrap(static_cast<unsigned>(lval[i]) + static_cast<unsigned>(rval[i]));
+}
+
+void subScalar(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = wrap(static_cast<unsigned>(lval[i]) - static_cast<unsigned>(rval[i]));
+}
+
+void mulScalar(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = wrap(static_cast<unsigned>(lval[i]) * static_cast<unsigned>(rval));
+}
+
+void divScalar(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    if (rval == -1) {
+        for (unsigned i = 0; i < size; ++i)
+            dst[i] = wrap(0u - static_cast<unsigned>(lval[i]));
+        return;
+    }
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = lval[i] / rval;
+}
+
+void modScalar(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    if (rval == -1) {
+        for (unsigned i = 0; i < size; ++i)
+            dst[i] = 0;
+        return;
+    }
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = lval[i] % rval;
+}
+
+void negScalar(possibleValue *dst, const possibleValue *val, unsigned size) {
+    for (unsigned i = 0; i < size; ++i)
+        dst[i] = wrap(0u - static_cast<unsigned>(val[i]));
+}
+
+unsigned mismatchScalar(const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    while (i < size && lval[i] == rval[i])
+        ++i;
+    return i;
+}
+
+const Kernels scalarKernels = {
+    Kernels::Scalar, "scalar",
+    addScalar, subScalar, mulScalar, divScalar, modScalar, negScalar, mismatchScalar
+};
+
+#ifdef KERNELS_X86
+
+// Integer division goes through doubles: every int32 quotient is exact in
+// double precision, and truncating it gives the same result as idiv.
+
+__attribute__((target("sse4.1")))
+void addSse(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rval + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi32(l, r));
+    }
+    addScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void subSse(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rval + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi32(l, r));
+    }
+    subScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void mulSse(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m128i r = _mm_set1_epi32(rval);
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_mullo_epi32(l, r));
+    }
+    mulScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i quotientSse(__m128i l, __m128d r) {
+    __m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(l), r));
+    __m128i hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(l, 8)), r));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+__attribute__((target("sse4.1")))
+void divSse(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m128d r = _mm_set1_pd(static_cast<double>(rval));
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), quotientSse(l, r));
+    }
+    divScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void modSse(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m128d r = _mm_set1_pd(static_cast<double>(rval));
+    __m128i ri = _mm_set1_epi32(rval);
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i q = quotientSse(l, r);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi32(l, _mm_mullo_epi32(q, ri)));
+    }
+    modScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("sse4.1")))
+void negSse(possibleValue *dst, const possibleValue *val, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(val + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi32(_mm_setzero_si128(), v));
+    }
+    negScalar(dst + i, val + i, size - i);
+}
+
+__attribute__((target("sse4.1")))
+unsigned mismatchSse(const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rval + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(l, r)));
+        if (mask != 0xFFFFu)
+            return i + __builtin_ctz(~mask) / 4;
+    }
+    return i + mismatchScalar(lval + i, rval + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void addAvx2(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lval + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rval + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi32(l, r));
+    }
+    addScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void subAvx2(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lval + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rval + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_sub_epi32(l, r));
+    }
+    subScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+__attribute__((target("avx2")))
+void mulAvx2(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m256i r = _mm256_set1_epi32(rval);
+    for (; i + 8 <= size; i += 8) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lval + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_mullo_epi32(l, r));
+    }
+    mulScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("avx2")))
+void divAvx2(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m256d r = _mm256_set1_pd(static_cast<double>(rval));
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i q = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(l), r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), q);
+    }
+    divScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("avx2")))
+void modAvx2(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    __m256d r = _mm256_set1_pd(static_cast<double>(rval));
+    __m128i ri = _mm_set1_epi32(rval);
+    for (; i + 4 <= size; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lval + i));
+        __m128i q = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(l), r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_sub_epi32(l, _mm_mullo_epi32(q, ri)));
+    }
+    modScalar(dst + i, lval + i, rval, size - i);
+}
+
+__attribute__((target("avx2")))
+void negAvx2(possibleValue *dst, const possibleValue *val, unsigned size) {
+    unsigned i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(val + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_sub_epi32(_mm256_setzero_si256(), v));
+    }
+    negScalar(dst + i, val + i, size - i);
+}
+
+__attribute__((target("avx2")))
+unsigned mismatchAvx2(const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lval + i));
+        __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rval + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi32(l, r)));
+        if (mask != 0xFFFFFFFFu)
+            return i + __builtin_ctz(~mask) / 4;
+    }
+    return i + mismatchScalar(lval + i, rval + i, size - i);
+}
+
+const Kernels sseKernels = {
+    Kernels::SSE41, "sse4.1",
+    addSse, subSse, mulSse, divSse, modSse, negSse, mismatchSse
+};
+
+const Kernels avx2Kernels = {
+    Kernels::AVX2, "avx2",
+    addAvx2, subAvx2, mulAvx2, divAvx2, modAvx2, negAvx2, mismatchAvx2
+};
+
+#endif
+
+#ifdef KERNELS_NEON
+
+void addNeon(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_s32(dst + i, vaddq_s32(vld1q_s32(lval + i), vld1q_s32(rval + i)));
+    addScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+void subNeon(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_s32(dst + i, vsubq_s32(vld1q_s32(lval + i), vld1q_s32(rval + i)));
+    subScalar(dst + i, lval + i, rval + i, size - i);
+}
+
+void mulNeon(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_s32(dst + i, vmulq_n_s32(vld1q_s32(lval + i), rval));
+    mulScalar(dst + i, lval + i, rval, size - i);
+}
+
+inline int32x4_t quotientNeon(int32x4_t l, float64x2_t r) {
+    float64x2_t lo = vcvtq_f64_s64(vmovl_s32(vget_low_s32(l)));
+    float64x2_t hi = vcvtq_f64_s64(vmovl_high_s32(l));
+    int64x2_t qlo = vcvtq_s64_f64(vdivq_f64(lo, r));
+    int64x2_t qhi = vcvtq_s64_f64(vdivq_f64(hi, r));
+    return vcombine_s32(vmovn_s64(qlo), vmovn_s64(qhi));
+}
+
+void divNeon(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    float64x2_t r = vdupq_n_f64(static_cast<double>(rval));
+    for (; i + 4 <= size; i += 4)
+        vst1q_s32(dst + i, quotientNeon(vld1q_s32(lval + i), r));
+    divScalar(dst + i, lval + i, rval, size - i);
+}
+
+void modNeon(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size) {
+    unsigned i = 0;
+    float64x2_t r = vdupq_n_f64(static_cast<double>(rval));
+    int32x4_t ri = vdupq_n_s32(rval);
+    for (; i + 4 <= size; i += 4) {
+        int32x4_t l = vld1q_s32(lval + i);
+        vst1q_s32(dst + i, vmlsq_s32(l, quotientNeon(l, r), ri));
+    }
+    modScalar(dst + i, lval + i, rval, size - i);
+}
+
+void negNeon(possibleValue *dst, const possibleValue *val, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4)
+        vst1q_s32(dst + i, vnegq_s32(vld1q_s32(val + i)));
+    negScalar(dst + i, val + i, size - i);
+}
+
+unsigned mismatchNeon(const possibleValue *lval, const possibleValue *rval, unsigned size) {
+    unsigned i = 0;
+    for (; i + 4 <= size; i += 4) {
+        uint32x4_t eq = vceqq_s32(vld1q_s32(lval + i), vld1q_s32(rval + i));
+        if (vminvq_u32(eq) != 0xFFFFFFFFu)
+            break;
+    }
+    return i + mismatchScalar(lval + i, rval + i, size - i);
+}
+
+const Kernels neonKernels = {
+    Kernels::NEON, "neon",
+    addNeon, subNeon, mulNeon, divNeon, modNeon, negNeon, mismatchNeon
+};
+
+#endif
+
+const Kernels& select() {
+#ifdef KERNELS_X86
+    if (const Kernels *kernels = Kernels::forIsa(Kernels::AVX2)) return *kernels;
+    if (const Kernels *kernels = Kernels::forIsa(Kernels::SSE41)) return *kernels;
+#endif
+#ifdef KERNELS_NEON
+    return neonKernels;
+#endif
+    return scalarKernels;
+}
+
+}
+
+const Kernels& Kernels::get() {
+    static const Kernels &selected = select();
+    return selected;
+}
+
+const Kernels* Kernels::forIsa(Isa isa) {
+    switch (isa) {
+        case Scalar:
+            return &scalarKernels;
+#ifdef KERNELS_X86
+        case SSE41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1") ? &sseKernels : nullptr;
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? &avx2Kernels : nullptr;
+#endif
+#ifdef KERNELS_NEON
+        case NEON:
+            return &neonKernels;
+#endif
+        default:
+            return nullptr;
+    }
+}
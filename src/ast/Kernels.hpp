@@ -0,0 +1,44 @@
+#ifndef PARSER_KERNELS_HPP_
+#define PARSER_KERNELS_HPP_
+
+#include "ValueVec.hpp"
+
+namespace ast
+{
+
+// Element-wise loops behind the Var operators. The best implementation the
+// running CPU supports is picked once, on first use. Every kernel accepts
+// dst being exactly one of its sources, which is how the in-place operators
+// work.
+struct Kernels
+{
+    enum Isa {
+        Scalar,
+        SSE41,
+        AVX2,
+        NEON
+    };
+
+    typedef void (*Binary)(possibleValue *dst, const possibleValue *lval, const possibleValue *rval, unsigned size);
+    typedef void (*WithScalar)(possibleValue *dst, const possibleValue *lval, possibleValue rval, unsigned size);
+    typedef void (*Unary)(possibleValue *dst, const possibleValue *val, unsigned size);
+    typedef unsigned (*Mismatch)(const possibleValue *lval, const possibleValue *rval, unsigned size);
+
+    Isa isa;
+    const char *name;
+    Binary add;
+    Binary sub;
+    WithScalar mul;
+    WithScalar div;         // rval != 0
+    WithScalar mod;         // rval != 0
+    Unary neg;
+    Mismatch mismatch;      // index of the first differing element, or size
+
+    static const Kernels& get();
+    // nullptr when the CPU can't run the given implementation
+    static const Kernels* forIsa(Isa isa);
+};
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include "Optimizer.hpp"
+
+#include <stdexcept>
+#include "expression/BaseMathExpr.hpp"
+#include "expression/CachedExpr.hpp"
+#include "statement/BlockStatement.hpp"
+
+using namespace ast;
+
+void Optimizer::function(BlockStatement &root_) {
+    root = &root_;
+    root->optimize(*this);
+
+    // a store kept alive can make another one live, repeat until it settles
+    reads.assign(root->frameSize(), false);
+    do {
+        grown = false;
+        root->reads(*this);
+    } while (grown);
+    root->prune(*this);
+
+    root = nullptr;
+}
+
+Expression* Optimizer::fold(Expression *expr) {
+    Var value;
+    try {
+        Frame frame(context, 0);
+        value = expr->calculate(frame);
+    } catch (std::exception &) {
+        return expr;
+    }
+    return arena.make<BaseMathExpr>(arena.make<Var>(value));
+}
+
+bool Optimizer::isOne(const Var *value) {
+    return value != nullptr && value->value.size() == 1 && value->value[0] == 1;
+}
+
+void Optimizer::beginLoop() {
+    writes.assign(root->frameSize(), false);
+    flags.clear();
+}
+
+void Optimizer::write(Slot slot) {
+    if (slot.index >= writes.size())
+        writes.resize(slot.index + 1, false);
+    writes[slot.index] = true;
+}
+
+bool Optimizer::written(Slot slot) const {
+    return slot.index < writes.size() && writes[slot.index];
+}
+
+Expression* Optimizer::cache(Expression *expr) {
+    Slot value = root->addTemporary();
+    Slot flag = root->addTemporary();
+    flags.push_back(flag);
+    return arena.make<CachedExpr>(expr, value, flag);
+}
+
+Span<Slot> Optimizer::endLoop() {
+    writes.clear();
+    return arena.copy(flags);
+}
+
+void Optimizer::read(Slot slot) {
+    if (slot.index >= reads.size())
+        reads.resize(slot.index + 1, false);
+    if (!reads[slot.index]) {
+        reads[slot.index] = true;
+        grown = true;
+    }
+}
+
+bool Optimizer::live(Slot slot) const {
+    return slot.index < reads.size() && reads[slot.index];
+}
@@ -0,0 +1,64 @@
+#ifndef AST_OPTIMIZER_HPP_
+#define AST_OPTIMIZER_HPP_
+
+#include <vector>
+#include "Arena.hpp"
+#include "Context.hpp"
+#include "Frame.hpp"
+
+namespace ast
+{
+
+class Expression;
+class BlockStatement;
+
+// Pass over a parsed function body, driven by the nodes' optimize() and
+// hoist(). It folds constant subtrees, drops identities that can't change a
+// value (x*1, 1*x, x/1, -(-x)) and single-child wrappers, and moves loop
+// invariant subexpressions into cached slots computed once per loop entry.
+// Anything that throws when evaluated is left in place, so errors still
+// happen at run time and at the same point. Last, statements after a
+// return, break or continue and stores of a literal or a variable into a
+// slot nothing reads are dropped.
+class Optimizer
+{
+public:
+    explicit Optimizer(Arena &arena_) : arena(arena_) {}
+
+    void function(BlockStatement &root);
+
+    // a literal holding the value of expr, which has only literal operands;
+    // expr itself when evaluating it fails
+    Expression* fold(Expression *expr);
+    static bool isOne(const Var *value);
+
+    template <class T>
+    Span<T> span(const std::vector<T> &items) { return arena.copy(items); }
+    Arena& getArena() { return arena; }
+
+    // WhileStatement marks what its body writes between beginLoop() and
+    // endLoop(); expressions cached in between are reset through the
+    // returned flags when the loop is entered
+    void beginLoop();
+    void write(Slot slot);
+    bool written(Slot slot) const;
+    Expression* cache(Expression *expr);
+    Span<Slot> endLoop();
+
+    // reads() of the statements left mark the slots whose stores are needed
+    void read(Slot slot);
+    bool live(Slot slot) const;
+
+private:
+    Arena &arena;
+    BlockStatement *root = nullptr;
+    Context context;
+    std::vector<bool> writes;
+    std::vector<Slot> flags;
+    std::vector<bool> reads;
+    bool grown = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+using namespace ast;
+
+namespace
+{
+
+double millis(Profiler::Clock::duration time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+}
+
+void Profiler::enter(const std::string &name) {
+    auto id = ids.find(name);
+    if (id == ids.end()) {
+        id = ids.insert({name, static_cast<unsigned>(functions.size())}).first;
+        functions.emplace_back();
+        functions.back().name = name;
+    }
+    unsigned function = id->second;
+
+    unsigned parent = stack.empty() ? root : stack.back().node;
+    auto child = children.find({parent, function});
+    if (child == children.end()) {
+        child = children.insert({{parent, function}, static_cast<unsigned>(nodes.size())}).first;
+        nodes.push_back(Node{function, parent, Clock::duration(0)});
+    }
+
+    ++functions[function].calls;
+    ++functions[function].active;
+    stack.push_back(Call{child->second, Clock::now(), Clock::duration(0)});
+}
+
+void Profiler::leave() {
+    Call call = stack.back();
+    stack.pop_back();
+
+    Clock::duration elapsed = Clock::now() - call.start;
+    Node &node = nodes[call.node];
+    Function &function = functions[node.function];
+    node.self += elapsed - call.children;
+    function.exclusive += elapsed - call.children;
+    if (--function.active == 0)
+        function.inclusive += elapsed;
+    if (!stack.empty())
+        stack.back().children += elapsed;
+}
+
+void Profiler::hit(int line) {
+    if (!stack.empty())
+        ++functions[nodes[stack.back().node].function].lines[line];
+}
+
+void Profiler::report(std::ostream &out) const {
+    std::vector<const Function*> order;
+    for (auto &function : functions)
+        order.push_back(&function);
+    std::sort(order.begin(), order.end(), [](const Function *a, const Function *b) {
+        return a->exclusive > b->exclusive;
+    });
+
+    out << std::left << std::setw(24) << "function" << std::right
+        << std::setw(12) << "calls" << std::setw(16) << "inclusive ms" << std::setw(16) << "exclusive ms" << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (auto function : order)
+        out << std::left << std::setw(24) << function->name << std::right
+            << std::setw(12) << function->calls
+            << std::setw(16) << millis(function->inclusive)
+            << std::setw(16) << millis(function->exclusive) << '\n';
+
+    std::vector<std::pair<std::string, std::uint64_t>> lines;
+    for (auto &function : functions)
+        for (auto &line : function.lines)
+            lines.push_back({function.name + ":" + std::to_string(line.first), line.second});
+    std::sort(lines.begin(), lines.end(), [](const auto &a, const auto &b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+
+    out << '\n' << std::left << std::setw(24) << "line" << std::right << std::setw(12) << "hits" << '\n';
+    for (auto &line : lines)
+        out << std::left << std::setw(24) << line.first << std::right << std::setw(12) << line.second << '\n';
+    out << std::defaultfloat;
+}
+
+void Profiler::collapsed(std::ostream &out) const {
+    for (auto &node : nodes) {
+        std::string path = functions[node.function].name;
+        for (unsigned up = node.parent; up != root; up = nodes[up].parent)
+            path = functions[nodes[up].function].name + ";" + path;
+        out << path << ' ' << std::chrono::duration_cast<std::chrono::microseconds>(node.self).count() << '\n';
+    }
+}
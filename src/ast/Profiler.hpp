@@ -0,0 +1,92 @@
+#ifndef AST_PROFILER_HPP_
+#define AST_PROFILER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ast
+{
+
+// Calls, inclusive and exclusive time of every function a run calls, script
+// functions and builtins alike, and how often each statement line of a
+// function runs. Calls are also kept as a tree, so time can be reported
+// per call stack. Runs only collect it when their Context has a profiler;
+// without one, blocks and calls take their usual path.
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // keeps a call on the stack of profiler, if there is one, for as long
+    // as it lives, so a call that throws is left as well
+    class Scope
+    {
+    public:
+        Scope(Profiler *profiler_, const std::string &name) : profiler(profiler_) {
+            if (profiler) profiler->enter(name);
+        }
+        ~Scope() {
+            if (profiler) profiler->leave();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler *profiler;
+    };
+
+    void enter(const std::string &name);
+    void leave();
+    // a statement at line of the function on top of the stack is run
+    void hit(int line);
+
+    // functions by exclusive time, then the most run lines
+    void report(std::ostream &out) const;
+    // one "main;f;g <microseconds>" line per call stack, with the time
+    // spent in g itself on that stack; what flamegraph.pl reads
+    void collapsed(std::ostream &out) const;
+
+private:
+    struct Function {
+        std::string name;
+        std::uint64_t calls = 0;
+        Clock::duration inclusive{0};
+        Clock::duration exclusive{0};
+        // calls of it on the stack right now; recursive calls don't add to
+        // inclusive time again
+        unsigned active = 0;
+        std::unordered_map<int, std::uint64_t> lines;
+    };
+
+    // a distinct call stack, identified by its caller's node and function
+    struct Node {
+        unsigned function;
+        unsigned parent;
+        Clock::duration self{0};
+    };
+
+    struct Call {
+        unsigned node;
+        Clock::time_point start;
+        Clock::duration children{0};
+    };
+
+    static const unsigned root = ~0u;
+
+    std::vector<Function> functions;
+    std::unordered_map<std::string, unsigned> ids;
+    std::vector<Node> nodes;
+    std::map<std::pair<unsigned, unsigned>, unsigned> children;
+    std::vector<Call> stack;
+};
+
+}
+
+#endif
@@ -1,42 +1,250 @@
 #ifndef AST_PROGRAM_HPP_
 #define AST_PROGRAM_HPP_
 
-#include <unordered_map>
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "statement/FunctionDefStatement.hpp"
+#include "statement/FunctionCallStatement.hpp"
+#include "Builtin.hpp"
+#include "Arena.hpp"
 #include "Return.hpp"
+#include "Budget.hpp"
+#include "Error.hpp"
+#include "Profiler.hpp"
+#include "../util/Interner.hpp"
 
 namespace ast
 {
 
+// Functions and builtins are kept in flat tables indexed by the id their
+// name has in the program's interner, which the parser's scanner shares.
 class Program
 {
 public:
-    Program() {}
+    Program()
+        : symbols(std::make_shared<util::Interner>()), mainSymbol(symbols->intern("main").id) {}
+
+    // names of functions, builtins and variables of the program
+    const std::shared_ptr<util::Interner>& getSymbols() const { return symbols; }
 
     void addFunction(std::unique_ptr<FunctionDefinition> newFunc) {
-        functions.insert({newFunc->getId(), std::move(newFunc)});
+        unsigned symbol = symbols->intern(newFunc->getId()).id;
+        if (lookup(symbol))
+            throw std::runtime_error("Function already defined: " + newFunc->getId());
+        newFunc->setOwner(*this);
+        if (functions.size() <= symbol)
+            functions.resize(symbol + 1);
+        functions[symbol] = std::move(newFunc);
+    }
+
+    // call whose callee wasn't parsed yet, see link()
+    void addUnresolved(FunctionCall &call) {
+        unresolved.push_back(&call);
     }
 
-    FunctionDefinition &findFunction(std::string identifier) {
-        return *functions.at(identifier);
+    // after a failed parse some pending calls may already be destroyed;
+    // those left unbound fail when they're reached instead
+    void discardUnresolved() {
+        unresolved.clear();
+    }
+
+    // moves functions, nodes and pending calls of another file's program
+    // into this one; nodes don't move, so the pending calls stay valid.
+    // Functions get the ids their names have here
+    void merge(Program &&other) {
+        arena.merge(std::move(other.arena));
+        for (auto &&function : other.functions)
+            if (function)
+                addFunction(std::move(function));
+        other.functions.clear();
+        unresolved.insert(unresolved.end(), other.unresolved.begin(), other.unresolved.end());
+        other.unresolved.clear();
+    }
+
+    // binds calls to functions defined later, or in another file, by name;
+    // the calls may come from a program interning names in another table
+    void link() {
+        link(*this);
+    }
+
+    // binds the pending calls of another program, like a lazily parsed
+    // function body, with this program's functions
+    void link(Program &other) {
+        for (auto call : other.unresolved) {
+            if (existFunction(call->getName()))
+                call->bind(findFunction(call->getName()));
+            else if (existBuiltin(call->getName()))
+                call->bind(findBuiltin(call->getName()));
+            else
+                throw std::runtime_error("Function not found: " + call->getName());
+
+            if (call->arity() != call->size())
+                throw std::runtime_error("Wrong number of parameters in functionCall");
+        }
+        other.unresolved.clear();
     }
 
-    bool existFunction(const std::string &identifier) {
-        return functions.count(identifier);
+    // links and merges the program a lazily parsed function body was read
+    // into. That happens while the program runs, on whichever thread first
+    // reaches the function, so bodies are adopted one at a time
+    void adopt(Program &&body) {
+        std::lock_guard<std::mutex> lock(adopting);
+        link(body);
+        merge(std::move(body));
     }
 
-    Return run() {
+    // swaps the functions named in removed for those of replacement, and
+    // binds every call of the program again by name, so calls to the old
+    // functions reach the new ones. Throws, leaving the program as it was,
+    // when a call wouldn't find its function or would pass the wrong
+    // number of arguments. Nodes of the removed functions stay in the
+    // arena until the program goes.
+    void replace(const std::vector<std::string> &removed, Program &&replacement) {
+        auto gone = [&removed](const std::string &id) {
+            return std::find(removed.begin(), removed.end(), id) != removed.end();
+        };
+        auto find = [this, &replacement, &gone](const std::string &id) -> FunctionDefinition* {
+            if (FunctionDefinition *function = replacement.lookup(id))
+                return function;
+            return gone(id) ? nullptr : lookup(id);
+        };
+        auto check = [this, &find](const FunctionDefinition &function) {
+            for (auto call : function.getCalls()) {
+                unsigned arity;
+                if (FunctionDefinition *callee = find(call->getName()))
+                    arity = callee->size();
+                else if (existBuiltin(call->getName()))
+                    arity = findBuiltin(call->getName()).arity;
+                else
+                    throw std::runtime_error("Function not found: " + call->getName());
+                if (arity != call->size())
+                    throw std::runtime_error("Wrong number of parameters in functionCall");
+            }
+        };
+
+        for (auto &&function : replacement.functions) {
+            if (!function)
+                continue;
+            if (lookup(function->getId()) && !gone(function->getId()))
+                throw std::runtime_error("Function already defined: " + function->getId());
+            check(*function);
+        }
+        for (auto &&function : functions)
+            if (function && !gone(function->getId()))
+                check(*function);
+
+        for (auto &id : removed) {
+            unsigned symbol = symbols->find(id);
+            if (symbol < functions.size())
+                functions[symbol].reset();
+        }
+        replacement.unresolved.clear();
+        merge(std::move(replacement));
         for (auto &&function : functions) {
-            if (function.second->getId() == "main") {
-                return function.second->run();
+            if (!function)
+                continue;
+            for (auto call : function->getCalls()) {
+                if (existFunction(call->getName()))
+                    call->bind(findFunction(call->getName()));
+                else
+                    call->bind(findBuiltin(call->getName()));
             }
         }
-        throw std::runtime_error("Program doesn't contain main function");
+    }
+
+    FunctionDefinition &findFunction(const std::string &identifier) {
+        if (FunctionDefinition *function = lookup(identifier))
+            return *function;
+        throw std::out_of_range("Function not found: " + identifier);
+    }
+
+    // by the id of its name in getSymbols()
+    FunctionDefinition &findFunction(unsigned symbol) {
+        if (FunctionDefinition *function = lookup(symbol))
+            return *function;
+        throw std::out_of_range("Function not found");
+    }
+
+    // every node of the program's functions is allocated here
+    Arena& getArena() { return arena; }
+
+    bool existFunction(const std::string &identifier) const {
+        return lookup(identifier);
+    }
+
+    bool existFunction(unsigned symbol) const {
+        return lookup(symbol);
+    }
+
+    // the builtin has to outlive the program, it isn't copied
+    void addBuiltin(const Builtin &builtin) {
+        unsigned symbol = symbols->intern(builtin.name).id;
+        if (builtins.size() <= symbol)
+            builtins.resize(symbol + 1, nullptr);
+        builtins[symbol] = &builtin;
+    }
+
+    const Builtin &findBuiltin(const std::string &identifier) const {
+        return findBuiltin(symbols->find(identifier));
+    }
+
+    const Builtin &findBuiltin(unsigned symbol) const {
+        if (!existBuiltin(symbol))
+            throw std::out_of_range("Function not found");
+        return *builtins[symbol];
+    }
+
+    bool existBuiltin(const std::string &identifier) const {
+        return existBuiltin(symbols->find(identifier));
+    }
+
+    bool existBuiltin(unsigned symbol) const {
+        return symbol < builtins.size() && builtins[symbol];
+    }
+
+    // a run keeps its state in a Context of its own and never changes the
+    // program, but for adopting lazily parsed bodies, so any number of
+    // threads can run it at once; a Profiler serves a single run though
+    Return run(bool jit = false, const Budget &budget = Budget(), Profiler *profiler = nullptr) const {
+        const FunctionDefinition *main = lookup(mainSymbol);
+        if (!main)
+            throw std::runtime_error("Program doesn't contain main function");
+
+        Context context;
+        context.enableJit(jit);
+        context.setBudget(budget);
+        context.setProfiler(profiler);
+        Profiler::Scope scope(profiler, main->getId());
+        Stats::Scope stats(main->getId());
+        Frame frame(context, main->frameSize());
+        try {
+            return main->run(frame);
+        } catch (RuntimeError &) {
+            RuntimeError::rethrow(0, main->getId());
+        }
     };
 
 private:
-    std::unordered_map<std::string, std::unique_ptr<FunctionDefinition>> functions;
+    FunctionDefinition* lookup(unsigned symbol) const {
+        return symbol < functions.size() ? functions[symbol].get() : nullptr;
+    }
+
+    // names not interned here can't name a function either
+    FunctionDefinition* lookup(const std::string &identifier) const {
+        return lookup(symbols->find(identifier));
+    }
+
+    Arena arena;
+    std::shared_ptr<util::Interner> symbols;
+    unsigned mainSymbol;
+    // indexed by symbol, empty where the name isn't a function
+    std::vector<std::unique_ptr<FunctionDefinition>> functions;
+    std::vector<const Builtin*> builtins;
+    std::vector<FunctionCall*> unresolved;
+    std::mutex adopting;
 };
 
 }
@@ -0,0 +1,80 @@
+#include "Stats.hpp"
+
+#include <iomanip>
+
+using namespace ast;
+
+Stats::Counters& Stats::Counters::operator+=(const Counters &rval) {
+    constructions += rval.constructions;
+    copies += rval.copies;
+    moves += rval.moves;
+    allocations += rval.allocations;
+    heapBytes += rval.heapBytes;
+    return *this;
+}
+
+void Stats::attach() {
+    attached = this;
+}
+
+void Stats::detach() {
+    if (attached == this)
+        attached = nullptr;
+}
+
+Stats::Counters* Stats::enter(std::string_view function) {
+    if (!attached)
+        return nullptr;
+    Counters *previous = attached->current;
+    auto counters = attached->byFunction.find(function);
+    if (counters == attached->byFunction.end())
+        counters = attached->byFunction.emplace(std::string(function), Counters()).first;
+    attached->current = &counters->second;
+    return previous;
+}
+
+void Stats::leave(Counters *previous) {
+    if (attached && previous)
+        attached->current = previous;
+}
+
+void Stats::allocate(std::size_t bytes) {
+    ++current->allocations;
+    current->heapBytes += bytes;
+    live += bytes;
+    if (live > peak)
+        peak = live;
+}
+
+// blocks allocated before attach() are freed without being counted
+void Stats::free(std::size_t bytes) {
+    live = bytes < live ? live - bytes : 0;
+}
+
+Stats::Counters Stats::total() const {
+    Counters sum;
+    for (auto &function : byFunction)
+        sum += function.second;
+    return sum;
+}
+
+void Stats::report(std::ostream &out) const {
+    auto row = [&out](const std::string &name, const Counters &counters) {
+        out << std::left << std::setw(24) << name << std::right
+            << std::setw(14) << counters.constructions
+            << std::setw(14) << counters.copies
+            << std::setw(14) << counters.moves
+            << std::setw(14) << counters.allocations
+            << std::setw(14) << counters.heapBytes << '\n';
+    };
+
+    out << std::left << std::setw(24) << "function" << std::right
+        << std::setw(14) << "constructed" << std::setw(14) << "copied" << std::setw(14) << "moved"
+        << std::setw(14) << "allocations" << std::setw(14) << "heap bytes" << '\n';
+    for (auto &function : byFunction)
+        if (!function.first.empty())
+            row(function.first, function.second);
+    row("(outside functions)", byFunction.at(""));
+    row("total", total());
+    out << "peak live vector bytes: " << peak << '\n';
+}
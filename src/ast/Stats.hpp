@@ -0,0 +1,88 @@
+#ifndef AST_STATS_HPP_
+#define AST_STATS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace ast
+{
+
+// Counts Var constructions, copies and moves, and the heap blocks vectors
+// allocate, split by the function they happen in. A Stats only sees the
+// thread it's attached to; on every other thread, and on this one when
+// nothing is attached, a Var or a vector block pays one thread local load
+// and a branch.
+class Stats
+{
+public:
+    struct Counters {
+        std::uint64_t constructions = 0;
+        std::uint64_t copies = 0;
+        std::uint64_t moves = 0;
+        std::uint64_t allocations = 0;
+        std::uint64_t heapBytes = 0;
+
+        Counters& operator+=(const Counters &rval);
+    };
+
+    // counting goes to the function on top; what happens outside of any
+    // function goes to an unnamed entry
+    class Scope
+    {
+    public:
+        explicit Scope(std::string_view function) : previous(enter(function)) {}
+        ~Scope() { leave(previous); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Counters *previous;
+    };
+
+    Stats() = default;
+    ~Stats() { detach(); }
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    // the calling thread counts into this until detach()
+    void attach();
+    void detach();
+
+    // makes function the one counted into, returning the one it was; for
+    // callers that can't keep a Scope, like the VM's dispatch loop
+    static Counters* enter(std::string_view function);
+    static void leave(Counters *previous);
+
+    static void constructed() { if (attached) ++attached->current->constructions; }
+    static void copied() { if (attached) ++attached->current->copies; }
+    static void moved() { if (attached) ++attached->current->moves; }
+    static void allocated(std::size_t bytes) { if (attached) attached->allocate(bytes); }
+    static void freed(std::size_t bytes) { if (attached) attached->free(bytes); }
+
+    const std::map<std::string, Counters, std::less<>>& functions() const { return byFunction; }
+    Counters total() const;
+    // most bytes of vector blocks alive at once
+    std::uint64_t peakBytes() const { return peak; }
+
+    void report(std::ostream &out) const;
+
+private:
+    void allocate(std::size_t bytes);
+    void free(std::size_t bytes);
+
+    static inline thread_local Stats *attached = nullptr;
+
+    std::map<std::string, Counters, std::less<>> byFunction;
+    Counters *current = &byFunction[""];
+    std::uint64_t live = 0;
+    std::uint64_t peak = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef PARSER_VALUEVEC_HPP_
+#define PARSER_VALUEVEC_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "Stats.hpp"
+
+typedef int possibleValue;
+
+namespace ast
+{
+
+// Vector of values keeping up to inlineCapacity elements inside the object.
+// Scalars and booleans, which is what loop counters and conditions are made
+// of, never touch the heap; only real vectors spill to heap storage.
+//
+// Heap storage is shared between copies and reference counted. Copying a
+// vector only bumps the count; whatever is about to write through it, the
+// non-const accessors included, first takes a private copy if the storage
+// is shared. Reads that don't need to write should go through a const
+// reference so they don't copy for nothing.
+//
+// A slice is a view of the same block starting at an offset, so slicing a
+// heap vector costs nothing until one of the two is written to.
+//
+// The block can also be part of a private file mapping (see mapped()), so
+// a vector loaded from a file is used where it lies; the last copy unmaps
+// it, and growing it moves it to the heap.
+class ValueVec
+{
+public:
+    typedef possibleValue value_type;
+    typedef possibleValue* iterator;
+    typedef const possibleValue* const_iterator;
+
+    static const unsigned inlineCapacity = 2;
+
+    ValueVec() : len(0), start(inlineStart), heap(nullptr) {}
+
+    explicit ValueVec(unsigned n, possibleValue val = 0) : ValueVec() {
+        resize(n, val);
+    }
+
+    ValueVec(std::initializer_list<possibleValue> init) : ValueVec() {
+        append(init.begin(), init.end());
+    }
+
+    ValueVec(const ValueVec &rval) : ValueVec() {
+        share(rval);
+    }
+
+    ValueVec(ValueVec &&rval) noexcept : ValueVec() {
+        steal(rval);
+    }
+
+    // bytes a mapping has to leave unused right before the values
+    static const size_t mappedHeader = 16;
+
+    // the count values at base + header of a read-write MAP_PRIVATE
+    // mapping of header + count values; the mappedHeader bytes before them
+    // are overwritten, and the mapping is unmapped with the last copy
+    static ValueVec mapped(void *base, size_t header, unsigned count) {
+        if (header < mappedHeader)
+            throw std::invalid_argument("ValueVec::mapped");
+        ValueVec vec;
+        char *values = static_cast<char*>(base) + header;
+        vec.heap = new (values - sizeof(Block)) Block{{1}, count, static_cast<unsigned>(header - sizeof(Block))};
+        vec.start = 0;
+        vec.len = count;
+        return vec;
+    }
+
+    ~ValueVec() {
+        release();
+    }
+
+    ValueVec& operator =(const ValueVec &rval) {
+        if (this != &rval) {
+            release();
+            share(rval);
+        }
+        return *this;
+    }
+
+    ValueVec& operator =(ValueVec &&rval) noexcept {
+        if (this != &rval) {
+            release();
+            steal(rval);
+        }
+        return *this;
+    }
+
+    unsigned size() const { return len; }
+    unsigned capacity() const { return isInline() ? inlineCapacity : heap->cap - start; }
+    bool empty() const { return len == 0; }
+
+    possibleValue* data() { unshare(); return storage(); }
+    const possibleValue* data() const { return storage(); }
+
+    iterator begin() { return data(); }
+    iterator end() { return data() + len; }
+    const_iterator begin() const { return data(); }
+    const_iterator end() const { return data() + len; }
+
+    possibleValue& operator[](unsigned idx) { return data()[idx]; }
+    const possibleValue& operator[](unsigned idx) const { return data()[idx]; }
+
+    possibleValue& at(unsigned idx) {
+        if (idx >= len) throw std::out_of_range("ValueVec::at");
+        return data()[idx];
+    }
+
+    const possibleValue& at(unsigned idx) const {
+        if (idx >= len) throw std::out_of_range("ValueVec::at");
+        return data()[idx];
+    }
+
+    void reserve(unsigned n) {
+        if (n > capacity() || shared()) grow(std::max(n, len));
+    }
+
+    void resize(unsigned n, possibleValue val = 0) {
+        reserve(n);
+        if (n > len) std::fill(data() + len, data() + n, val);
+        len = n;
+    }
+
+    // like resize, but new elements are left for the caller to overwrite
+    void resizeUninitialized(unsigned n) {
+        reserve(n);
+        len = n;
+    }
+
+    void clear() { len = 0; }
+
+    // just val, in the inline buffer
+    void assign(possibleValue val) {
+        release();
+        start = inlineStart;
+        buf[0] = val;
+        len = 1;
+    }
+
+    void push_back(possibleValue val) {
+        if (len == capacity() || shared()) grow(std::max(len * 2, inlineCapacity * 2));
+        storage()[len++] = val;
+    }
+
+    // appends [first, last), which may point into this vector; storage
+    // shared with other copies stays alive while they hold it
+    void append(const possibleValue *first, const possibleValue *last) {
+        unsigned count = last - first;
+        if (count == 0) return;
+        if (len + count > capacity() || shared()) {
+            const possibleValue *old = storage();
+            bool aliased = first >= old && first < old + len;
+            unsigned offset = first - old;
+            grow(std::max(len + count, len * 2));
+            if (aliased) first = storage() + offset;
+        }
+        std::memmove(storage() + len, first, count * sizeof(possibleValue));
+        len += count;
+    }
+
+    // [from, to) of this vector, which has to be in range
+    ValueVec slice(unsigned from, unsigned to) const {
+        ValueVec view;
+        if (isInline() || to - from <= inlineCapacity) {
+            view.append(storage() + from, storage() + to);
+        } else {
+            view.share(*this);
+            view.start += from;
+            view.len = to - from;
+        }
+        return view;
+    }
+
+    friend bool operator ==(const ValueVec &lval, const ValueVec &rval) {
+        if (lval.len != rval.len) return false;
+        return lval.storage() == rval.storage() || std::equal(lval.begin(), lval.end(), rval.begin());
+    }
+
+    friend bool operator <(const ValueVec &lval, const ValueVec &rval) {
+        return std::lexicographical_compare(lval.begin(), lval.end(), rval.begin(), rval.end());
+    }
+
+private:
+    struct Block {
+        std::atomic<unsigned> refs;
+        unsigned cap;
+        // offset of the block in its mapping, 0 for malloc'd ones
+        unsigned mapping;
+        possibleValue* values() { return reinterpret_cast<possibleValue*>(this + 1); }
+    };
+    static_assert(sizeof(Block) < mappedHeader, "a mapped block has to fit before the values");
+
+    // start of a vector kept in the inline buffer
+    static const unsigned inlineStart = ~0u;
+
+    static size_t bytes(unsigned cap) { return sizeof(Block) + cap * sizeof(possibleValue); }
+
+    static Block* allocate(unsigned n) {
+        void *mem = std::malloc(bytes(n));
+        if (!mem) throw std::bad_alloc();
+        Stats::allocated(bytes(n));
+        return new (mem) Block{{1}, n, 0};
+    }
+
+    bool isInline() const { return start == inlineStart; }
+    bool shared() const { return !isInline() && heap->refs.load(std::memory_order_acquire) != 1; }
+
+    possibleValue* storage() const { return isInline() ? const_cast<possibleValue*>(buf) : heap->values() + start; }
+
+    // makes room for n elements past start
+    void grow(unsigned n) {
+        if (!isInline() && !shared() && !heap->mapping) {
+            size_t old = bytes(heap->cap);
+            void *mem = std::realloc(heap, bytes(start + n));
+            if (!mem) throw std::bad_alloc();
+            Stats::freed(old);
+            Stats::allocated(bytes(start + n));
+            heap = static_cast<Block*>(mem);
+            heap->cap = start + n;
+        } else {
+            Block *block = allocate(n);
+            std::memcpy(block->values(), storage(), len * sizeof(possibleValue));
+            release();
+            heap = block;
+            start = 0;
+        }
+    }
+
+    // gives this vector storage of its own before it is written to; a view
+    // only takes its own elements along
+    void unshare() {
+        if (shared()) grow(std::max(len, inlineCapacity * 2));
+    }
+
+    void release() {
+        if (!isInline() && heap->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (heap->mapping) {
+                munmap(reinterpret_cast<char*>(heap) - heap->mapping, heap->mapping + bytes(heap->cap));
+                return;
+            }
+            Stats::freed(bytes(heap->cap));
+            std::free(heap);
+        }
+    }
+
+    // expects this vector to hold no heap storage
+    void share(const ValueVec &rval) {
+        len = rval.len;
+        start = rval.start;
+        if (rval.isInline()) {
+            std::memcpy(buf, rval.buf, rval.len * sizeof(possibleValue));
+        } else {
+            heap = rval.heap;
+            heap->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // expects this vector to hold no heap storage
+    void steal(ValueVec &rval) {
+        len = rval.len;
+        start = rval.start;
+        if (rval.isInline())
+            std::memcpy(buf, rval.buf, rval.len * sizeof(possibleValue));
+        else
+            heap = rval.heap;
+        rval.len = 0;
+        rval.start = inlineStart;
+    }
+
+    unsigned len;
+    // offset of the first element in the heap block
+    unsigned start;
+    union {
+        possibleValue buf[inlineCapacity];
+        Block *heap;
+    };
+};
+
+}
+
+#endif
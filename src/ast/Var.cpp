@@ -1,4 +1,5 @@
 #include "Var.hpp"
+#include "Kernels.hpp"
 
 using namespace ast;
 
@@ -10,12 +11,22 @@ const int &Var::operator[](int idx) const {
     return value[idx];
 }
 
-std::vector<int> &Var::operator*() {
+valueVec &Var::operator*() {
     return value;
 }
 
+namespace
+{
+
+const Kernels& kernels() {
+    return Kernels::get();
+}
+
+}
+
 Var Var::operator==(const Var &rval) const {
-    if (value == rval.value) {
+    unsigned size = value.size();
+    if (size == rval.value.size() && kernels().mismatch(value.data(), rval.value.data(), size) == size) {
         return vTrue();
     } else {
         return vFalse();
@@ -27,7 +38,10 @@ Var Var::operator!=(const Var &rval) const {
 }
 
 Var Var::operator<(const Var &rval) const {
-    if (value < rval.value) {
+    unsigned size = std::min(value.size(), rval.value.size());
+    unsigned idx = kernels().mismatch(value.data(), rval.value.data(), size);
+    bool less = idx < size ? value[idx] < rval.value[idx] : value.size() < rval.value.size();
+    if (less) {
         return vTrue();
     } else {
         return vFalse();
@@ -51,96 +65,132 @@ Var Var::operator+() const {
 }
 
 Var Var::operator-() const {
-    Var var(VarType::INT, std::vector<int>(value.size()));
-    for (unsigned int i = 0; i < value.size(); ++i) {
-        var[i] = -value[i];
-    }
+    Var var(VarType::INT, valueVec());
+    var.value.resizeUninitialized(value.size());
+    kernels().neg(var.value.data(), value.data(), value.size());
     return var;
 }
 
 Var Var::operator+(const Var &rval) const {
-    Var var;
-    if (value.size() == rval.value.size()) {
-        var = *this;
-        for (unsigned int i = 0; i < value.size(); ++i) {
-            var[i] += rval.value[i];
-        }
-    } else {
+    if (value.size() != rval.value.size())
         throw std::runtime_error("Cant add two vectors with different size");
-    }
 
+    Var var(type, valueVec());
+    var.value.resizeUninitialized(value.size());
+    kernels().add(var.value.data(), value.data(), rval.value.data(), value.size());
     return var;
 }
 
 Var Var::operator-(const Var &rval) const {
-    Var var;
-    if (value.size() == rval.value.size()) {
-        var = *this;
-        for (unsigned int i = 0; i < value.size(); ++i) {
-            var[i] -= rval.value[i];
-        }
-    } else {
+    if (value.size() != rval.value.size())
         throw std::runtime_error("Cant subtract two vectors with different size");
-    }
 
+    Var var(type, valueVec());
+    var.value.resizeUninitialized(value.size());
+    kernels().sub(var.value.data(), value.data(), rval.value.data(), value.size());
     return var;
 }
 
 Var Var::operator*(const Var &rval) const {
-    Var var;
+    const Var *vector;
+    possibleValue factor;
     if (value.size() == 1) {
-        var = rval;
-        for (auto &variable : var.value) {
-            variable *= value[0];
-        }
+        vector = &rval;
+        factor = value[0];
     } else if (rval.value.size() == 1) {
-        var = *this;
-        for (auto &variable : var.value) {
-            variable *= rval.value[0];
-        }
+        vector = this;
+        factor = rval.value[0];
     } else {
         throw std::runtime_error("Cant multiply vectors if they both contain more than 1 value");
     }
 
+    Var var(vector->type, valueVec());
+    var.value.resizeUninitialized(vector->value.size());
+    kernels().mul(var.value.data(), vector->value.data(), factor, vector->value.size());
     return var;
 }
 
 Var Var::operator/(const Var &rval) const {
-    Var var;
-    if (rval.value.size() == 1) {
-        var = *this;
-        for (auto &variable : var.value) {
-            if(rval.value[0]) {
-                variable /= rval.value[0];
-            } else {
-                throw std::runtime_error("Cannot divide by 0");
-            }
-        }
-    } else {
+    if (rval.value.size() != 1)
         throw std::runtime_error("vector dividing must be of size 1");
-    }
+    if (!rval.value[0] && !value.empty())
+        throw std::runtime_error("Cannot divide by 0");
 
+    Var var(type, valueVec());
+    var.value.resizeUninitialized(value.size());
+    kernels().div(var.value.data(), value.data(), rval.value[0], value.size());
     return var;
 }
 
 Var Var::operator%(const Var &rval) const {
-    Var var;
-    if (rval.value.size() == 1) {
-        var = *this;
-        for (auto &variable : var.value) {
-            if(rval.value[0]) {
-                variable %= rval.value[0];
-            } else {
-                throw std::runtime_error("Cannot modulo by 0");
-            }
-        }
-    } else {
+    if (rval.value.size() != 1)
         throw std::runtime_error("vector doing modulo must be of size 1");
-    }
+    if (!rval.value[0] && !value.empty())
+        throw std::runtime_error("Cannot modulo by 0");
 
+    Var var(type, valueVec());
+    var.value.resizeUninitialized(value.size());
+    kernels().mod(var.value.data(), value.data(), rval.value[0], value.size());
     return var;
 }
 
+Var& Var::operator+=(const Var &rval) {
+    if (value.size() != rval.value.size())
+        throw std::runtime_error("Cant add two vectors with different size");
+
+    kernels().add(value.data(), value.data(), rval.value.data(), value.size());
+    return *this;
+}
+
+Var& Var::operator-=(const Var &rval) {
+    if (value.size() != rval.value.size())
+        throw std::runtime_error("Cant subtract two vectors with different size");
+
+    kernels().sub(value.data(), value.data(), rval.value.data(), value.size());
+    return *this;
+}
+
+Var& Var::operator*=(const Var &rval) {
+    if (value.size() == 1) {
+        // scalar times vector takes the shape and type of the vector
+        possibleValue factor = value[0];
+        type = rval.type;
+        value.resizeUninitialized(rval.value.size());
+        kernels().mul(value.data(), rval.value.data(), factor, value.size());
+    } else if (rval.value.size() == 1) {
+        kernels().mul(value.data(), value.data(), rval.value[0], value.size());
+    } else {
+        throw std::runtime_error("Cant multiply vectors if they both contain more than 1 value");
+    }
+    return *this;
+}
+
+Var& Var::operator/=(const Var &rval) {
+    if (rval.value.size() != 1)
+        throw std::runtime_error("vector dividing must be of size 1");
+    if (!rval.value[0] && !value.empty())
+        throw std::runtime_error("Cannot divide by 0");
+
+    kernels().div(value.data(), value.data(), rval.value[0], value.size());
+    return *this;
+}
+
+Var& Var::operator%=(const Var &rval) {
+    if (rval.value.size() != 1)
+        throw std::runtime_error("vector doing modulo must be of size 1");
+    if (!rval.value[0] && !value.empty())
+        throw std::runtime_error("Cannot modulo by 0");
+
+    kernels().mod(value.data(), value.data(), rval.value[0], value.size());
+    return *this;
+}
+
+Var& Var::negate() {
+    type = VarType::INT;
+    kernels().neg(value.data(), value.data(), value.size());
+    return *this;
+}
+
 Var::operator bool() const {
     return !value.empty();
 }
@@ -176,7 +226,7 @@ unsigned int Var::size() {
 int &Var::at(unsigned idx) {
     // >= 0 checked because of unsigned IDX
     if (idx < value.size()) {
-        return value.at(idx);
+        return value[idx];
     } else {
         throw std::runtime_error("Index out of range");
     }
@@ -185,12 +235,20 @@ int &Var::at(unsigned idx) {
 const int &Var::at(unsigned idx) const {
     // >= 0 checked because of unsigned IDX
     if (idx < value.size()) {
-        return value.at(idx);
+        return value[idx];
     } else {
         throw std::runtime_error("Index out of range");
     }
 }
 
+Var Var::slice(int from, int to) const {
+    if (from >= to)
+        return Var(VarType::INT, valueVec());
+    if (from < 0 || static_cast<unsigned>(to) > value.size())
+        throw std::runtime_error("Index out of range");
+    return Var(VarType::INT, value.slice(from, to));
+}
+
 const std::string Var::toString() const {
     std::stringstream ss;
     ss << *this;
@@ -2,12 +2,11 @@
 #define PARSER_VAR_HPP_
 
 #include "VarType.hpp"
-#include <vector>
+#include "ValueVec.hpp"
 #include <iostream>
 #include <sstream>
 
-typedef int possibleValue;
-typedef std::vector<possibleValue> valueVec;
+typedef ast::ValueVec valueVec;
 
 namespace ast
 {
@@ -16,16 +15,33 @@ class Var
 {
 public:
     Var() :
-        type(VarType::UNDEFINED), value({}) {}
+        type(VarType::UNDEFINED), value({}) { Stats::constructed(); }
 
     Var(VarType type_, valueVec value_) :
-        type(type_), value(value_) {}
+        type(type_), value(std::move(value_)) { Stats::constructed(); }
     
-    Var(Var&& rval) : value(std::move(rval.value)) {}
+    Var(Var&& rval) noexcept : type(rval.type), value(std::move(rval.value)) { Stats::moved(); }
 
+    // [1] or (); both fit the inline buffer, so nothing is allocated
+    static Var boolean(bool value) {
+        return value ? Var(VarType::INT, valueVec(1, 1)) : Var();
+    }
 
-    Var& operator =(const Var& rval) = default;
-    Var(const Var&) = default;
+
+    // copies and moves are counted, see Stats
+    Var& operator =(const Var& rval) {
+        Stats::copied();
+        type = rval.type;
+        value = rval.value;
+        return *this;
+    }
+    Var& operator =(Var&& rval) noexcept {
+        Stats::moved();
+        type = rval.type;
+        value = std::move(rval.value);
+        return *this;
+    }
+    Var(const Var& rval) : type(rval.type), value(rval.value) { Stats::copied(); }
 
     VarType getDataType() { return type; }
     valueVec getValue() { return value; }
@@ -42,7 +58,7 @@ public:
     }
     int& operator[](int idx);
     const int& operator[](int idx) const;
-    std::vector<int>& operator*();
+    valueVec& operator*();
 
     Var operator==(const Var &rval) const;
     Var operator!=(const Var &rval) const;
@@ -61,6 +77,14 @@ public:
     Var operator/(const Var &rval) const;
     Var operator%(const Var &rval) const;
 
+    // in-place versions, reusing this variable's storage
+    Var& operator+=(const Var &rval);
+    Var& operator-=(const Var &rval);
+    Var& operator*=(const Var &rval);
+    Var& operator/=(const Var &rval);
+    Var& operator%=(const Var &rval);
+    Var& negate();
+
     Var operator!() const;
     Var operator&&(const Var &rval) const;
     Var operator||(const Var &rval) const;
@@ -72,6 +96,8 @@ public:
 
     int& at(unsigned idx);
     const int& at(unsigned idx) const;
+    // [from, to) sharing this variable's storage; empty if from >= to
+    Var slice(int from, int to) const;
     unsigned int size();
     VarType type;
     valueVec value;
@@ -79,10 +105,10 @@ public:
 private:
 
     Var vTrue() const {
-        return Var(VarType::INT, std::vector<int>(1, 1));
+        return boolean(true);
     }
     Var vFalse() const {
-        return Var();
+        return boolean(false);
     }
 };
 
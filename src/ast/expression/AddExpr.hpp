@@ -2,10 +2,11 @@
 #define AST_ADDXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
 #include "../Var.hpp"
 #include "../../scanner/TokenType.hpp"
 #include "MultiExpr.hpp"
-#include <list>
+#include <iterator>
 
 using namespace scanner;
 
@@ -15,34 +16,20 @@ namespace ast
 class AddExpr : public Expression
 {
 public:
-    AddExpr(exprPtr expr_) {
-        exprs.push_back(std::move(expr_));
-    }
-
-    AddExpr(AddExpr &&rval) 
-        : exprs(std::move(rval.exprs)),
-          addOps(std::move(rval.addOps)) {}
+    // exprs has one element more than addOps, the operators between them
+    AddExpr(Span<exprPtr> exprs_, Span<TokenType> addOps_)
+        : exprs(exprs_), addOps(addOps_) {}
 
-    void addPlus(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        addOps.push_back(TokenType::T_Plus);
-    }
-
-    void addMinus(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        addOps.push_back(TokenType::T_Minus);
-    }
-
-    virtual Var calculate() const {
+    virtual Var calculate(Frame &frame) const {
         auto itExpr = exprs.begin();
-        Var var = itExpr->get()->calculate();
+        Var var = (*itExpr)->calculate(frame);
 
         for (auto &&op : addOps) {
             ++itExpr;
             if (op == TokenType::T_Plus)
-                var = var + itExpr->get()->calculate();
+                var += (*itExpr)->calculate(frame);
             else if (op == TokenType::T_Minus)
-                var = var - itExpr->get()->calculate();
+                var -= (*itExpr)->calculate(frame);
             else
                 throw std::runtime_error("Bad TokenType in additiveOps");
         }
@@ -50,9 +37,96 @@ public:
         return var;
     }
 
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        auto itExpr = exprs.begin();
+        if (addOps.empty()) {
+            (*itExpr)->compile(compiler, dst);
+            return;
+        }
+
+        unsigned lhs = compiler.operand(**itExpr);
+        for (auto it = addOps.begin(); it != addOps.end(); ++it) {
+            ++itExpr;
+            unsigned rhs = compiler.operand(**itExpr);
+            unsigned out = std::next(it) == addOps.end() ? dst : compiler.temp();
+            vm::OpCode code;
+            if (*it == TokenType::T_Plus)
+                code = vm::OpCode::Add;
+            else if (*it == TokenType::T_Minus)
+                code = vm::OpCode::Sub;
+            else
+                throw std::runtime_error("Bad TokenType in additiveOps");
+            compiler.emit(code, out, lhs, rhs);
+            lhs = out;
+        }
+    }
+
+    virtual const Slot* directVariable() const {
+        return addOps.empty() ? exprs.front()->directVariable() : nullptr;
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        if (addOps.empty())
+            return exprs.front()->assignTo(frame, slot);
+
+        const Slot *lhs = exprs.front()->directVariable();
+        if (addOps.size() != 1 || lhs == nullptr || lhs->index != slot.index)
+            return false;
+
+        Var rhs = exprs[1]->calculate(frame);
+        if (addOps.front() == TokenType::T_Plus)
+            frame[slot] += rhs;
+        else
+            frame[slot] -= rhs;
+        return true;
+    }
+
+    virtual void flatten(FlatCode &code) const {
+        auto itExpr = exprs.begin();
+        (*itExpr)->flatten(code);
+        for (auto it = addOps.begin(); it != addOps.end(); ++it) {
+            (*++itExpr)->flatten(code);
+            if (*it == TokenType::T_Plus)
+                code.emit(FlatOp::Add);
+            else
+                code.emit(FlatOp::Sub);
+        }
+    }
+
+    virtual Expression* optimize(Optimizer &opt) {
+        bool constant = true;
+        for (auto &expr : exprs) {
+            expr = expr->optimize(opt);
+            constant = constant && expr->literalValue() != nullptr;
+        }
+        if (exprs.size() == 1)
+            return exprs.front();
+        return constant ? opt.fold(this) : this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        if (invariant(opt))
+            return opt.cache(this);
+        for (auto &expr : exprs)
+            expr = expr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        for (auto expr : exprs)
+            if (!expr->invariant(opt))
+                return false;
+        return true;
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        for (auto expr : exprs)
+            expr->reads(opt);
+    }
+
 private:
-    std::list<exprPtr> exprs;
-    std::list<TokenType> addOps;
+    Span<exprPtr> exprs;
+    Span<TokenType> addOps;
 };
 
 }
@@ -2,9 +2,9 @@
 #define AST_BASELOGICEXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
 #include "../Var.hpp"
 #include "AddExpr.hpp"
-#include <list>
 
 namespace ast
 {
@@ -13,19 +13,57 @@ class BaseLogicExpr : public Expression
 {
 public:
     BaseLogicExpr(exprPtr expr_, bool unary_ = false) 
-    : unary(unary_) {
-        exprs.push_back(std::move(expr_));
+    : expr(expr_), unary(unary_) {}
+
+    virtual Var calculate(Frame &frame) const {
+        return unary ? !expr->calculate(frame) : expr->calculate(frame);
+    }
+
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        if (unary)
+            compiler.emit(vm::OpCode::Not, dst, compiler.operand(*expr));
+        else
+            expr->compile(compiler, dst);
+    }
+
+    virtual const Slot* directVariable() const {
+        return unary ? nullptr : expr->directVariable();
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        return !unary && expr->assignTo(frame, slot);
     }
 
-    BaseLogicExpr(BaseLogicExpr &&rval) 
-    : exprs(std::move(rval.exprs)), unary(rval.unary) {} 
+    virtual void flatten(FlatCode &code) const {
+        expr->flatten(code);
+        if (unary)
+            code.emit(FlatOp::Not);
+    }
+
+    virtual Expression* optimize(Optimizer &opt) {
+        expr = expr->optimize(opt);
+        if (!unary)
+            return expr;
+        return expr->literalValue() != nullptr ? opt.fold(this) : this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        if (invariant(opt))
+            return opt.cache(this);
+        expr = expr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        return expr->invariant(opt);
+    }
 
-    virtual Var calculate() const {
-        return unary ? !exprs.begin()->get()->calculate() : exprs.begin()->get()->calculate();
+    virtual void reads(Optimizer &opt) const {
+        expr->reads(opt);
     }
     
 private:
-    std::list<exprPtr> exprs;
+    exprPtr expr;
     bool unary;
 };
 
@@ -2,6 +2,8 @@
 #define AST_BASEMATHEXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
+#include "../statement/Statement.hpp"
 #include <iostream>
 
 namespace ast
@@ -11,80 +13,207 @@ class BaseMathExpr : public Expression
 {
 public:
     BaseMathExpr() = delete;
-    BaseMathExpr(Var* literal_, bool unary_ = false) : literal(literal_), unary(unary_) {}
+    // literal lives in the arena, like the nodes
+    BaseMathExpr(const Var* literal_, bool unary_ = false) : literal(literal_), unary(unary_) {}
 
-    BaseMathExpr(Var& variable_, bool unary_)
-        : variable(&variable_), unary(unary_) {}
+    BaseMathExpr(Slot variable_, bool unary_)
+        : variable(variable_), isVariable(true), unary(unary_) {}
 
-    BaseMathExpr(std::unique_ptr<Statement> funCall_, bool unary_)
-        : unary(unary_), funCall(std::move(funCall_)) {}
+    BaseMathExpr(Statement* funCall_, bool unary_)
+        : unary(unary_), funCall(funCall_) {}
 
-    BaseMathExpr(Var& variable_, std::unique_ptr<Expression> index_, bool unary_ = false) : 
-        variable(&variable_), unary(unary_), index(std::move(index_)) {}
+    BaseMathExpr(Slot variable_, exprPtr index_, bool unary_ = false) : 
+        variable(variable_), isVariable(true), unary(unary_), index(index_) {}
 
-    BaseMathExpr(Var& variable_, std::unique_ptr<Expression> sIdx1_, std::unique_ptr<Expression> sIdx2_, bool unary_ = false) : 
-        variable(&variable_), unary(unary_), sIdx1(std::move(sIdx1_)), sIdx2(std::move(sIdx2_)) {}
+    BaseMathExpr(Slot variable_, exprPtr sIdx1_, exprPtr sIdx2_, bool unary_ = false) : 
+        variable(variable_), isVariable(true), unary(unary_), sIdx1(sIdx1_), sIdx2(sIdx2_) {}
 
 
-    BaseMathExpr(std::unique_ptr<Expression> expr_, bool unary_)
-        : unary(unary_), parentLogicExpr(std::move(expr_)) {}
+    BaseMathExpr(exprPtr expr_, bool unary_)
+        : unary(unary_), parentLogicExpr(expr_) {}
 
-    BaseMathExpr(BaseMathExpr &&rval)
-        : literal(rval.literal),
-          variable(rval.variable),
-          unary(rval.unary),
-          funCall(std::move(rval.funCall)),
-          parentLogicExpr(std::move(rval.parentLogicExpr)) {
-
-        rval.unary = false;
-        rval.literal = nullptr;
-    }
-
-    ~BaseMathExpr() { delete literal; }
-
-    virtual Var calculate() const {
+    virtual Var calculate(Frame &frame) const {
         Var currVar;
         if (literal) {
             currVar = *literal;
-        } else if (variable) {
+        } else if (isVariable) {
+            const Var &var = frame[variable];
             if (index != nullptr) {
-                int idx = index->calculate().value[0];
-                currVar = Var(VarType::INT, valueVec({variable->at(static_cast<unsigned int>(idx))}));
+                int idx = index->calculate(frame).value[0];
+                currVar = Var(VarType::INT, valueVec({var.at(static_cast<unsigned int>(idx))}));
             }
             else if (sIdx1 != nullptr) {
                 if (sIdx2 != nullptr) {
-                    int idx1 = sIdx1->calculate().value[0];
-                    int idx2 = sIdx2->calculate().value[0];
-                    valueVec tmp;
-                    for ( int i = idx1; i < idx2; ++i)
-                        tmp.push_back(variable->at(static_cast<unsigned int>(i)));
-                    currVar = Var(VarType::INT, tmp);
+                    int idx1 = sIdx1->calculate(frame).value[0];
+                    int idx2 = sIdx2->calculate(frame).value[0];
+                    currVar = var.slice(idx1, idx2);
                 }
             } else {
-                currVar = *variable;
+                currVar = var;
             }
         } else if (funCall != nullptr) {
-            currVar = funCall->run().variable;
+            currVar = funCall->run(frame).variable;
         } else if (parentLogicExpr != nullptr) {
-            currVar = parentLogicExpr->calculate();
+            currVar = parentLogicExpr->calculate(frame);
         }
 
         if (unary) {
-            currVar = -currVar;
+            currVar.negate();
         }
         return currVar;
     }
 
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        if (literal) {
+            compiler.emit(vm::OpCode::LoadConst, dst, compiler.constant(*literal));
+        } else if (isVariable) {
+            unsigned var = compiler.variable(variable);
+            if (index != nullptr) {
+                compiler.emit(vm::OpCode::Index, dst, var, compiler.operand(*index));
+            } else if (sIdx1 != nullptr) {
+                if (sIdx2 != nullptr) {
+                    unsigned from = compiler.temp();
+                    unsigned to = compiler.temp();
+                    sIdx1->compile(compiler, from);
+                    sIdx2->compile(compiler, to);
+                    compiler.emit(vm::OpCode::Slice, dst, var, from);
+                } else {
+                    compiler.emit(vm::OpCode::LoadConst, dst, compiler.constant(Var()));
+                }
+            } else if (unary) {
+                compiler.emit(vm::OpCode::Neg, dst, var);
+                return;
+            } else {
+                compiler.emit(vm::OpCode::Move, dst, var);
+            }
+        } else if (funCall != nullptr) {
+            funCall->compileValue(compiler, dst);
+        } else if (parentLogicExpr != nullptr) {
+            parentLogicExpr->compile(compiler, dst);
+        } else {
+            compiler.emit(vm::OpCode::LoadConst, dst, compiler.constant(Var()));
+        }
+
+        if (unary) {
+            compiler.emit(vm::OpCode::Neg, dst, dst);
+        }
+    }
+
+    virtual const Slot* directVariable() const {
+        return (isVariable && index == nullptr && sIdx1 == nullptr && !unary) ? &variable : nullptr;
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        return parentLogicExpr != nullptr && !unary && parentLogicExpr->assignTo(frame, slot);
+    }
+
+    virtual void flatten(FlatCode &code) const {
+        if (literal) {
+            code.constant(literal);
+        } else if (isVariable) {
+            if (index != nullptr) {
+                index->flatten(code);
+                code.emit(FlatOp::Index, variable.index);
+            } else if (sIdx1 != nullptr && sIdx2 != nullptr) {
+                sIdx1->flatten(code);
+                sIdx2->flatten(code);
+                code.emit(FlatOp::Slice, variable.index);
+            } else if (sIdx1 != nullptr) {
+                code.eval(this);
+                return;
+            } else {
+                code.emit(FlatOp::Load, variable.index);
+            }
+        } else if (funCall != nullptr) {
+            code.call(funCall);
+        } else if (parentLogicExpr != nullptr) {
+            parentLogicExpr->flatten(code);
+        } else {
+            code.eval(this);
+            return;
+        }
+
+        if (unary)
+            code.emit(FlatOp::Neg);
+    }
+
+    virtual Expression* optimize(Optimizer &opt) {
+        if (literal) {
+            return unary ? opt.fold(this) : this;
+        } else if (isVariable) {
+            if (index != nullptr) index = index->optimize(opt);
+            if (sIdx1 != nullptr) sIdx1 = sIdx1->optimize(opt);
+            if (sIdx2 != nullptr) sIdx2 = sIdx2->optimize(opt);
+        } else if (funCall != nullptr) {
+            funCall->optimize(opt);
+        } else if (parentLogicExpr != nullptr) {
+            parentLogicExpr = parentLogicExpr->optimize(opt);
+            if (!unary)
+                return parentLogicExpr;
+            if (parentLogicExpr->literalValue() != nullptr)
+                return opt.fold(this);
+            // -(-x)
+            auto inner = dynamic_cast<BaseMathExpr*>(parentLogicExpr);
+            if (inner != nullptr && inner->unary) {
+                inner->unary = false;
+                return inner;
+            }
+        }
+        return this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        // reading a variable costs as much as reading the cache
+        if (literal || (isVariable && index == nullptr && sIdx1 == nullptr))
+            return this;
+        if (invariant(opt))
+            return opt.cache(this);
+
+        if (index != nullptr) index = index->hoist(opt);
+        if (sIdx1 != nullptr) sIdx1 = sIdx1->hoist(opt);
+        if (sIdx2 != nullptr) sIdx2 = sIdx2->hoist(opt);
+        if (funCall != nullptr) funCall->hoist(opt);
+        if (parentLogicExpr != nullptr) parentLogicExpr = parentLogicExpr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        if (literal)
+            return true;
+        if (isVariable)
+            return !opt.written(variable)
+                && (index == nullptr || index->invariant(opt))
+                && (sIdx1 == nullptr || sIdx1->invariant(opt))
+                && (sIdx2 == nullptr || sIdx2->invariant(opt));
+        if (funCall != nullptr)
+            return funCall->invariant(opt);
+        return parentLogicExpr != nullptr && parentLogicExpr->invariant(opt);
+    }
+
+    virtual const Var* literalValue() const {
+        return unary ? nullptr : literal;
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        if (isVariable) opt.read(variable);
+        if (index != nullptr) index->reads(opt);
+        if (sIdx1 != nullptr) sIdx1->reads(opt);
+        if (sIdx2 != nullptr) sIdx2->reads(opt);
+        if (funCall != nullptr) funCall->reads(opt);
+        if (parentLogicExpr != nullptr) parentLogicExpr->reads(opt);
+    }
+
 private:
-    Var* literal = nullptr;
-    Var* variable = nullptr;
+    const Var* literal = nullptr;
+    Slot variable = {0};
+    bool isVariable = false;
     bool unary;
-    std::unique_ptr<Expression> index;
-    std::unique_ptr<Expression> sIdx1;
-    std::unique_ptr<Expression> sIdx2;
+    exprPtr index = nullptr;
+    exprPtr sIdx1 = nullptr;
+    exprPtr sIdx2 = nullptr;
 
-    std::unique_ptr<Statement> funCall;
-    std::unique_ptr<Expression> parentLogicExpr;
+    Statement* funCall = nullptr;
+    exprPtr parentLogicExpr = nullptr;
 };
 
 }
@@ -0,0 +1,48 @@
+#ifndef AST_CACHEDEXPRESSION_HPP
+#define AST_CACHEDEXPRESSION_HPP
+
+#include "Expression.hpp"
+
+namespace ast
+{
+
+// Loop invariant expression, evaluated the first time the loop reaches it
+// and kept in a slot of its own until the loop is entered again, which
+// clears flag.
+class CachedExpr : public Expression
+{
+public:
+    CachedExpr(exprPtr expr_, Slot value_, Slot flag_)
+        : expr(expr_), value(value_), flag(flag_) {}
+
+    virtual Var calculate(Frame &frame) const {
+        if (!static_cast<bool>(frame[flag])) {
+            frame[value] = expr->calculate(frame);
+            frame[flag] = Var(VarType::INT, valueVec(1, 1));
+        }
+        return frame[value];
+    }
+
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        unsigned cached = compiler.variable(value);
+        unsigned computed = compiler.variable(flag);
+        size_t skip = compiler.emit(vm::OpCode::JumpIfTrue, computed);
+        expr->compile(compiler, cached);
+        compiler.emit(vm::OpCode::LoadConst, computed, compiler.constant(Var(VarType::INT, valueVec(1, 1))));
+        compiler.patch(skip, compiler.label());
+        compiler.emit(vm::OpCode::Move, dst, cached);
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        expr->reads(opt);
+    }
+
+private:
+    exprPtr expr;
+    Slot value;
+    Slot flag;
+};
+
+}
+
+#endif
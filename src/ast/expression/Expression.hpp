@@ -1,20 +1,43 @@
 #ifndef AST_EXPRESSION_HPP
 #define AST_EXPRESSION_HPP
 
-#include <memory>
+#include "../Arena.hpp"
 #include "../Var.hpp"
+#include "../Frame.hpp"
+#include "FlatCode.hpp"
+#include "../../vm/Compiler.hpp"
 
 namespace ast
 {
 
+class Optimizer;
 
 class Expression
 {
 public:
     virtual ~Expression() = default;
-    virtual Var calculate() const = 0;
+    virtual Var calculate(Frame &frame) const = 0;
+    // emits code leaving the value of the expression in register dst
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const = 0;
+    // variable read as-is by this expression, so its register can be used directly
+    virtual const Slot* directVariable() const { return nullptr; }
+    // stores the value into slot, updating it in place when the expression
+    // is slot op something; false if the caller has to assign it itself
+    virtual bool assignTo(Frame &, Slot) const { return false; }
+    // appends the postfix steps of the expression, see FlatExpr
+    virtual void flatten(FlatCode &code) const { code.eval(this); }
+
+    // see Optimizer; both return the node replacing this one
+    virtual Expression* optimize(Optimizer &) { return this; }
+    virtual Expression* hoist(Optimizer &) { return this; }
+    // doesn't read anything the loop being optimized writes
+    virtual bool invariant(const Optimizer &) const { return false; }
+    // marks the slots the expression reads
+    virtual void reads(Optimizer &) const {}
+    virtual const Var* literalValue() const { return nullptr; }
 };
-using exprPtr = std::unique_ptr<Expression>;
+// nodes are owned by the Program's Arena
+using exprPtr = Expression*;
 
 }
 
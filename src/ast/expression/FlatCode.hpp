@@ -0,0 +1,130 @@
+#ifndef AST_FLATCODE_HPP
+#define AST_FLATCODE_HPP
+
+#include <algorithm>
+#include <vector>
+
+namespace ast
+{
+
+class Var;
+class Expression;
+class Statement;
+
+// One step of an expression in postfix order, see FlatExpr.
+struct FlatOp
+{
+    enum Code : unsigned char {
+        Const,          // push *literal
+        Load,           // push variable arg
+        Index,          // replace the index on top with variable arg at it
+        Slice,          // replace the two bounds on top with a slice of variable arg
+        Call,           // push the value of call
+        Eval,           // push the value of expr, for nodes without a flat form
+        Neg,
+        Not,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Eq,
+        Ne,
+        Lt,
+        Gt,
+        Le,
+        Ge,
+        And,
+        Or,
+        Bool,           // replace the top with [1] or ()
+        JumpIfFalse,    // to arg, the top stays on the stack
+        JumpIfTrue
+    };
+
+    Code code;
+    unsigned arg;
+    union {
+        const Var *literal;
+        const Expression *expr;
+        Statement *call;
+    };
+};
+
+// Expression::flatten() appends the steps of a node here, keeping track of
+// how deep the value stack gets.
+class FlatCode
+{
+public:
+    unsigned emit(FlatOp::Code code, unsigned arg = 0) {
+        FlatOp op;
+        op.code = code;
+        op.arg = arg;
+        op.literal = nullptr;
+        return push(op);
+    }
+
+    void constant(const Var *literal) {
+        FlatOp op;
+        op.code = FlatOp::Const;
+        op.arg = 0;
+        op.literal = literal;
+        push(op);
+    }
+
+    void call(Statement *call) {
+        FlatOp op;
+        op.code = FlatOp::Call;
+        op.arg = 0;
+        op.call = call;
+        push(op);
+    }
+
+    void eval(const Expression *expr) {
+        FlatOp op;
+        op.code = FlatOp::Eval;
+        op.arg = 0;
+        op.expr = expr;
+        push(op);
+    }
+
+    // points the jump emitted at index at the next step
+    void patch(unsigned at) { ops[at].arg = ops.size(); }
+
+    // change of the stack depth made by code
+    static int effect(FlatOp::Code code) {
+        switch (code) {
+            case FlatOp::Const:
+            case FlatOp::Load:
+            case FlatOp::Call:
+            case FlatOp::Eval:
+                return 1;
+            case FlatOp::Index:
+            case FlatOp::Neg:
+            case FlatOp::Not:
+            case FlatOp::Bool:
+            case FlatOp::JumpIfFalse:
+            case FlatOp::JumpIfTrue:
+                return 0;
+            default:
+                return -1;
+        }
+    }
+
+    const std::vector<FlatOp>& getOps() const { return ops; }
+    unsigned maxDepth() const { return deepest; }
+
+private:
+    unsigned push(const FlatOp &op) {
+        depth += effect(op.code);
+        deepest = std::max(deepest, depth);
+        ops.push_back(op);
+        return ops.size() - 1;
+    }
+
+    std::vector<FlatOp> ops;
+    unsigned depth = 0;
+    unsigned deepest = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef AST_FLATEXPRESSION_HPP
+#define AST_FLATEXPRESSION_HPP
+
+#include "Expression.hpp"
+#include "FlatCode.hpp"
+#include "../Optimizer.hpp"
+#include "../statement/Statement.hpp"
+
+namespace ast
+{
+
+// Root of an expression tree in postfix form. The tree-walker evaluates it
+// with one switch over a value stack instead of a virtual call per node and
+// per wrapper; bytecode is still compiled from the tree.
+class FlatExpr : public Expression
+{
+public:
+    FlatExpr(exprPtr tree_, Span<FlatOp> ops_, unsigned depth_)
+        : tree(tree_), ops(ops_), depth(depth_) {
+        findInPlace();
+    }
+
+    virtual Var calculate(Frame &frame) const {
+        Stack stack(frame.context(), depth);
+        return std::move(*execute(frame, stack.slots - 1, 0, ops.size()));
+    }
+
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        tree->compile(compiler, dst);
+    }
+
+    virtual const Slot* directVariable() const {
+        return tree->directVariable();
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        if (!inPlace || ops.front().arg != slot.index)
+            return false;
+
+        Stack stack(frame.context(), depth);
+        Var *rhs = execute(frame, stack.slots - 1, 1, ops.size() - 1);
+        switch (ops[ops.size() - 1].code) {
+            case FlatOp::Add: frame[slot] += *rhs; break;
+            case FlatOp::Sub: frame[slot] -= *rhs; break;
+            case FlatOp::Mul: frame[slot] *= *rhs; break;
+            default: frame[slot] /= *rhs; break;
+        }
+        return true;
+    }
+
+    virtual void flatten(FlatCode &code) const {
+        tree->flatten(code);
+    }
+
+    // the root stays, the tree under it is replaced and flattened again
+    virtual Expression* optimize(Optimizer &opt) {
+        tree = tree->optimize(opt);
+        reflatten(opt);
+        return this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        tree = tree->hoist(opt);
+        reflatten(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        return tree->invariant(opt);
+    }
+
+    virtual const Var* literalValue() const {
+        return tree->literalValue();
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        tree->reads(opt);
+    }
+
+private:
+    // value stack of one evaluation, carved out of the Context like frames
+    struct Stack {
+        Stack(Context &context_, unsigned size_)
+            : context(context_), slots(context_.allocate(size_)), size(size_) {}
+        ~Stack() { context.release(slots, size); }
+
+        Context &context;
+        Var *slots;
+        unsigned size;
+    };
+
+    // slot op rhs, where the lhs is the slot alone, can update it in place
+    void findInPlace() {
+        inPlace = false;
+        if (ops.size() >= 3 && ops.front().code == FlatOp::Load && isArithmetic(ops[ops.size() - 1].code)) {
+            int stack = 1;
+            inPlace = true;
+            for (unsigned i = 1; i + 1 < ops.size() && inPlace; ++i) {
+                stack += FlatCode::effect(ops[i].code);
+                inPlace = stack > 1;
+            }
+        }
+    }
+
+    void reflatten(Optimizer &opt) {
+        FlatCode code;
+        tree->flatten(code);
+        ops = opt.span(code.getOps());
+        depth = code.maxDepth();
+        findInPlace();
+    }
+
+    static bool isArithmetic(FlatOp::Code code) {
+        return code == FlatOp::Add || code == FlatOp::Sub || code == FlatOp::Mul || code == FlatOp::Div;
+    }
+
+    // runs steps [from, to) over the stack whose top is at top, returns the new top
+    Var* execute(Frame &frame, Var *top, unsigned from, unsigned to) const {
+        for (unsigned pc = from; pc < to; ) {
+            const FlatOp &op = ops[pc++];
+            switch (op.code) {
+                case FlatOp::Const:
+                    *++top = *op.literal; break;
+                case FlatOp::Load:
+                    *++top = frame[Slot{op.arg}]; break;
+                case FlatOp::Index: {
+                    const Var &var = frame[Slot{op.arg}];
+                    int idx = top->value[0];
+                    *top = Var(VarType::INT, valueVec({var.at(static_cast<unsigned int>(idx))}));
+                    break;
+                }
+                case FlatOp::Slice: {
+                    const Var &var = frame[Slot{op.arg}];
+                    int idx1 = top[-1].value[0];
+                    int idx2 = top->value[0];
+                    *--top = var.slice(idx1, idx2);
+                    break;
+                }
+                case FlatOp::Call:
+                    *++top = std::move(op.call->run(frame).variable); break;
+                case FlatOp::Eval:
+                    *++top = op.expr->calculate(frame); break;
+                case FlatOp::Neg:
+                    top->negate(); break;
+                case FlatOp::Not:
+                    *top = !*top; break;
+                case FlatOp::Add:
+                    top[-1] += *top; --top; break;
+                case FlatOp::Sub:
+                    top[-1] -= *top; --top; break;
+                case FlatOp::Mul:
+                    top[-1] *= *top; --top; break;
+                case FlatOp::Div:
+                    top[-1] /= *top; --top; break;
+                case FlatOp::Eq:
+                    top[-1] = top[-1] == *top; --top; break;
+                case FlatOp::Ne:
+                    top[-1] = top[-1] != *top; --top; break;
+                case FlatOp::Lt:
+                    top[-1] = top[-1] < *top; --top; break;
+                case FlatOp::Gt:
+                    top[-1] = top[-1] > *top; --top; break;
+                case FlatOp::Le:
+                    top[-1] = top[-1] <= *top; --top; break;
+                case FlatOp::Ge:
+                    top[-1] = top[-1] >= *top; --top; break;
+                case FlatOp::And:
+                    top[-1] = top[-1] && *top; --top; break;
+                case FlatOp::Or:
+                    top[-1] = top[-1] || *top; --top; break;
+                case FlatOp::Bool:
+                    *top = Var::boolean(static_cast<bool>(*top)); break;
+                case FlatOp::JumpIfFalse:
+                    if (!static_cast<bool>(*top)) pc = op.arg;
+                    break;
+                case FlatOp::JumpIfTrue:
+                    if (static_cast<bool>(*top)) pc = op.arg;
+                    break;
+            }
+        }
+        return top;
+    }
+
+    exprPtr tree;
+    Span<FlatOp> ops;
+    unsigned depth;
+    bool inPlace = false;
+};
+
+}
+
+#endif
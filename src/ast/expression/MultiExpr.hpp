@@ -2,10 +2,11 @@
 #define AST_MULTIEXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
 #include "../Var.hpp"
 #include "../../scanner/TokenType.hpp"
 #include "BaseMathExpr.hpp"
-#include <list>
+#include <iterator>
 
 using namespace scanner;
 
@@ -15,35 +16,21 @@ namespace ast
 class MultiExpr : public Expression
 {
 public:
-    MultiExpr(exprPtr expr_) {
-        exprs.push_back(std::move(expr_));
-    }
-
-
-    MultiExpr(MultiExpr &&rval) 
-        : exprs(std::move(rval.exprs)),
-          multiOps(std::move(rval.multiOps)) {}
-
-    void addMultiply(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        multiOps.push_back(TokenType::T_Asterisk);
-    }
-    void addDivide(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        multiOps.push_back(TokenType::T_Slash);
-    }
+    // exprs has one element more than multiOps, the operators between them
+    MultiExpr(Span<exprPtr> exprs_, Span<TokenType> multiOps_)
+        : exprs(exprs_), multiOps(multiOps_) {}
 
-    virtual Var calculate() const {
+    virtual Var calculate(Frame &frame) const {
         auto itExpr = exprs.begin();
-        Var var = itExpr->get()->calculate();
+        Var var = (*itExpr)->calculate(frame);
 
         for (auto &&op : multiOps) {
 
             ++itExpr;
             if (op == TokenType::T_Asterisk)
-                var = var * itExpr->get()->calculate();
+                var *= (*itExpr)->calculate(frame);
             else if (op == TokenType::T_Slash)
-                var = var / itExpr->get()->calculate();
+                var /= (*itExpr)->calculate(frame);
             else
                 throw std::runtime_error("Bad TokenType in multiplicativeOps");
         }
@@ -51,9 +38,120 @@ public:
         return var;
     }
 
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        auto itExpr = exprs.begin();
+        if (multiOps.empty()) {
+            (*itExpr)->compile(compiler, dst);
+            return;
+        }
+
+        unsigned lhs = compiler.operand(**itExpr);
+        for (auto it = multiOps.begin(); it != multiOps.end(); ++it) {
+            ++itExpr;
+            unsigned rhs = compiler.operand(**itExpr);
+            unsigned out = std::next(it) == multiOps.end() ? dst : compiler.temp();
+            vm::OpCode code;
+            if (*it == TokenType::T_Asterisk)
+                code = vm::OpCode::Mul;
+            else if (*it == TokenType::T_Slash)
+                code = vm::OpCode::Div;
+            else
+                throw std::runtime_error("Bad TokenType in multiplicativeOps");
+            compiler.emit(code, out, lhs, rhs);
+            lhs = out;
+        }
+    }
+
+    virtual const Slot* directVariable() const {
+        return multiOps.empty() ? exprs.front()->directVariable() : nullptr;
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        if (multiOps.empty())
+            return exprs.front()->assignTo(frame, slot);
+
+        const Slot *lhs = exprs.front()->directVariable();
+        if (multiOps.size() != 1 || lhs == nullptr || lhs->index != slot.index)
+            return false;
+
+        Var rhs = exprs[1]->calculate(frame);
+        if (multiOps.front() == TokenType::T_Asterisk)
+            frame[slot] *= rhs;
+        else
+            frame[slot] /= rhs;
+        return true;
+    }
+
+    virtual void flatten(FlatCode &code) const {
+        auto itExpr = exprs.begin();
+        (*itExpr)->flatten(code);
+        for (auto it = multiOps.begin(); it != multiOps.end(); ++it) {
+            (*++itExpr)->flatten(code);
+            if (*it == TokenType::T_Asterisk)
+                code.emit(FlatOp::Mul);
+            else
+                code.emit(FlatOp::Div);
+        }
+    }
+
+    // x*1, x/1 and 1*x are x whatever the shape of x
+    virtual Expression* optimize(Optimizer &opt) {
+        bool constant = true;
+        for (auto &expr : exprs) {
+            expr = expr->optimize(opt);
+            constant = constant && expr->literalValue() != nullptr;
+        }
+        if (exprs.size() == 1)
+            return exprs.front();
+        if (constant)
+            return opt.fold(this);
+
+        std::vector<exprPtr> kept{exprs.front()};
+        std::vector<TokenType> keptOps;
+        auto itExpr = exprs.begin();
+        for (auto op : multiOps) {
+            exprPtr rhs = *++itExpr;
+            if (Optimizer::isOne(rhs->literalValue()))
+                continue;
+            if (keptOps.empty() && op == TokenType::T_Asterisk && Optimizer::isOne(kept.front()->literalValue())) {
+                kept.front() = rhs;
+                continue;
+            }
+            kept.push_back(rhs);
+            keptOps.push_back(op);
+        }
+        if (kept.size() == 1)
+            return kept.front();
+        if (kept.size() != exprs.size()) {
+            exprs = opt.span(kept);
+            multiOps = opt.span(keptOps);
+        }
+        return this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        if (invariant(opt))
+            return opt.cache(this);
+        for (auto &expr : exprs)
+            expr = expr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        for (auto expr : exprs)
+            if (!expr->invariant(opt))
+                return false;
+        return true;
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        for (auto expr : exprs)
+            expr->reads(opt);
+    }
+
 private:
-    std::list<exprPtr> exprs;
-    std::list<TokenType> multiOps;
+    Span<exprPtr> exprs;
+    Span<TokenType> multiOps;
 };
 
 }
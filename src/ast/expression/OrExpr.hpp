@@ -2,9 +2,11 @@
 #define AST_OREXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
 #include "../Var.hpp"
 #include "AndExpr.hpp"
-#include <list>
+#include <iterator>
+#include <vector>
 
 namespace ast
 {
@@ -12,31 +14,98 @@ namespace ast
 class OrExpr : public Expression
 {
 public:
-    OrExpr(exprPtr expr_) {
-        exprs.push_back(std::move(expr_));
+    explicit OrExpr(Span<exprPtr> exprs_) : exprs(exprs_) {}
+
+    // operands after the first true one aren't evaluated
+    virtual Var calculate(Frame &frame) const {
+        if (exprs.size() == 1)
+            return exprs.front()->calculate(frame);
+
+        for (auto expr : exprs)
+            if (expr->calculate(frame))
+                return Var::boolean(true);
+        return Var::boolean(false);
+    }
+
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        if (exprs.size() == 1) {
+            exprs.front()->compile(compiler, dst);
+            return;
+        }
+
+        unsigned acc = compiler.temp();
+        std::vector<size_t> jumps;
+        exprs.front()->compile(compiler, acc);
+
+        for(auto it = exprs.begin() + 1; it!=exprs.end(); ++it) {
+            jumps.push_back(compiler.emit(vm::OpCode::JumpIfTrue, acc));
+            compiler.emit(vm::OpCode::Or, acc, acc, compiler.operand(**it));
+        }
+        // a jump leaves the true operand itself in acc
+        for (auto jump : jumps)
+            compiler.patch(jump, compiler.label());
+        compiler.emit(vm::OpCode::Or, acc, acc, acc);
+
+        compiler.emit(vm::OpCode::Move, dst, acc);
     }
 
-    OrExpr(OrExpr &&rval)
-        : exprs(std::move(rval.exprs)) {}
+    virtual const Slot* directVariable() const {
+        return exprs.size() == 1 ? exprs.front()->directVariable() : nullptr;
+    }
 
-    void addOr(exprPtr expr) {
-        exprs.push_back(std::move(expr));
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        return exprs.size() == 1 && exprs.front()->assignTo(frame, slot);
     }
 
-    virtual Var calculate() const {
-        Var var = exprs.begin()->get()->calculate();
+    // like calculate(), stops at the first true operand
+    virtual void flatten(FlatCode &code) const {
+        std::vector<unsigned> jumps;
+        exprs.front()->flatten(code);
 
-        for(auto it = ++exprs.begin(); it!=exprs.end(); ++it) {
-            var = var || it->get()->calculate();
-            if (var)
-                break;
+        for(auto it = exprs.begin() + 1; it!=exprs.end(); ++it) {
+            jumps.push_back(code.emit(FlatOp::JumpIfTrue));
+            (*it)->flatten(code);
+            code.emit(FlatOp::Or);
         }
+        for (auto jump : jumps)
+            code.patch(jump);
+        if (!jumps.empty())
+            code.emit(FlatOp::Bool);
+    }
+
+    virtual Expression* optimize(Optimizer &opt) {
+        bool constant = true;
+        for (auto &expr : exprs) {
+            expr = expr->optimize(opt);
+            constant = constant && expr->literalValue() != nullptr;
+        }
+        if (exprs.size() == 1)
+            return exprs.front();
+        return constant ? opt.fold(this) : this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        if (invariant(opt))
+            return opt.cache(this);
+        for (auto &expr : exprs)
+            expr = expr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        for (auto expr : exprs)
+            if (!expr->invariant(opt))
+                return false;
+        return true;
+    }
 
-        return var;
+    virtual void reads(Optimizer &opt) const {
+        for (auto expr : exprs)
+            expr->reads(opt);
     }
 
 private:
-    std::list<exprPtr> exprs;
+    Span<exprPtr> exprs;
 };
 
 }
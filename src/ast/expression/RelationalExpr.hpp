@@ -2,9 +2,10 @@
 #define AST_RELATIONEXPRESSION_HPP
 
 #include "Expression.hpp"
+#include "../Optimizer.hpp"
 #include "../Var.hpp"
 #include "../../scanner/TokenType.hpp"
-#include <list>
+#include <iterator>
 
 using namespace scanner;
 
@@ -13,57 +14,28 @@ namespace ast
 class RelationExpr : public Expression
 {
 public:
-    RelationExpr(exprPtr expr_) {
-        exprs.push_back(std::move(expr_));
-    }
-
-    RelationExpr(RelationExpr &&rhs)
-        : exprs(std::move(rhs.exprs)),
-          relationOps(std::move(rhs.relationOps)) {}
-
-    void addEqual(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_Equal2);
-    }
-    void addNotEqual(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_NotEqual);
-    }
-    void addLessThan(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_LessThan);
-    }
-    void addLessEqual(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_LeEqThan);
-    }
-    void addGreaterThan(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_GreaterThan);
-    }
-    void addGreaterEqual(exprPtr expr) {
-        exprs.push_back(std::move(expr));
-        relationOps.push_back(TokenType::T_GrEqThan);
-    }
+    // exprs has one element more than relationOps, the operators between them
+    RelationExpr(Span<exprPtr> exprs_, Span<TokenType> relationOps_)
+        : exprs(exprs_), relationOps(relationOps_) {}
 
-    virtual Var calculate() const {
+    virtual Var calculate(Frame &frame) const {
         auto itExpr = exprs.begin();
-        Var var = itExpr->get()->calculate();
+        Var var = (*itExpr)->calculate(frame);
 
         for (auto &&op : relationOps) {
             ++itExpr;
             if (op == TokenType::T_Equal2)
-                var = var == itExpr->get()->calculate();
+                var = var == (*itExpr)->calculate(frame);
             else if (op == TokenType::T_NotEqual)
-                var = var != itExpr->get()->calculate();
+                var = var != (*itExpr)->calculate(frame);
             else if (op == TokenType::T_LessThan)
-                var = var < itExpr->get()->calculate();
+                var = var < (*itExpr)->calculate(frame);
             else if (op == TokenType::T_LeEqThan)
-                var = var <= itExpr->get()->calculate();
+                var = var <= (*itExpr)->calculate(frame);
             else if (op == TokenType::T_GreaterThan)
-                var = var > itExpr->get()->calculate();
+                var = var > (*itExpr)->calculate(frame);
             else if (op == TokenType::T_GrEqThan)
-                var = var >= itExpr->get()->calculate();
+                var = var >= (*itExpr)->calculate(frame);
             else
                 throw std::runtime_error("Bad TokenType in relationOps");
         }
@@ -71,9 +43,100 @@ public:
         return var;
     }
 
+    virtual void compile(vm::Compiler &compiler, unsigned dst) const {
+        auto itExpr = exprs.begin();
+        if (relationOps.empty()) {
+            (*itExpr)->compile(compiler, dst);
+            return;
+        }
+
+        unsigned lhs = compiler.operand(**itExpr);
+        for (auto it = relationOps.begin(); it != relationOps.end(); ++it) {
+            ++itExpr;
+            unsigned rhs = compiler.operand(**itExpr);
+            unsigned out = std::next(it) == relationOps.end() ? dst : compiler.temp();
+            vm::OpCode code;
+            if (*it == TokenType::T_Equal2)
+                code = vm::OpCode::Eq;
+            else if (*it == TokenType::T_NotEqual)
+                code = vm::OpCode::Ne;
+            else if (*it == TokenType::T_LessThan)
+                code = vm::OpCode::Lt;
+            else if (*it == TokenType::T_LeEqThan)
+                code = vm::OpCode::Le;
+            else if (*it == TokenType::T_GreaterThan)
+                code = vm::OpCode::Gt;
+            else if (*it == TokenType::T_GrEqThan)
+                code = vm::OpCode::Ge;
+            else
+                throw std::runtime_error("Bad TokenType in relationOps");
+            compiler.emit(code, out, lhs, rhs);
+            lhs = out;
+        }
+    }
+
+    virtual const Slot* directVariable() const {
+        return relationOps.empty() ? exprs.front()->directVariable() : nullptr;
+    }
+
+    virtual bool assignTo(Frame &frame, Slot slot) const {
+        return relationOps.empty() && exprs.front()->assignTo(frame, slot);
+    }
+
+    virtual void flatten(FlatCode &code) const {
+        auto itExpr = exprs.begin();
+        (*itExpr)->flatten(code);
+        for (auto it = relationOps.begin(); it != relationOps.end(); ++it) {
+            (*++itExpr)->flatten(code);
+            if (*it == TokenType::T_Equal2)
+                code.emit(FlatOp::Eq);
+            else if (*it == TokenType::T_NotEqual)
+                code.emit(FlatOp::Ne);
+            else if (*it == TokenType::T_LessThan)
+                code.emit(FlatOp::Lt);
+            else if (*it == TokenType::T_LeEqThan)
+                code.emit(FlatOp::Le);
+            else if (*it == TokenType::T_GreaterThan)
+                code.emit(FlatOp::Gt);
+            else
+                code.emit(FlatOp::Ge);
+        }
+    }
+
+    virtual Expression* optimize(Optimizer &opt) {
+        bool constant = true;
+        for (auto &expr : exprs) {
+            expr = expr->optimize(opt);
+            constant = constant && expr->literalValue() != nullptr;
+        }
+        if (exprs.size() == 1)
+            return exprs.front();
+        return constant ? opt.fold(this) : this;
+    }
+
+    virtual Expression* hoist(Optimizer &opt) {
+        if (invariant(opt))
+            return opt.cache(this);
+        for (auto &expr : exprs)
+            expr = expr->hoist(opt);
+        return this;
+    }
+
+    virtual bool invariant(const Optimizer &opt) const {
+        for (auto expr : exprs)
+            if (!expr->invariant(opt))
+                return false;
+        return true;
+    }
+
+    virtual void reads(Optimizer &opt) const {
+        for (auto expr : exprs)
+            expr->reads(opt);
+    }
+
 private:
-    std::list<exprPtr> exprs;
-    std::list<TokenType> relationOps;
+    Span<exprPtr> exprs;
+    Span<TokenType> relationOps;
 };
 
 }
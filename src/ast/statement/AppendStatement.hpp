@@ -1,31 +1,42 @@
 #ifndef PARSER_APPENDSTATEMENT_HPP_
 #define PARSER_APPENDSTATEMENT_HPP_
 
-#include <list>
 #include <memory>
 #include "Statement.hpp"
 #include "../expression/Expression.hpp"
 #include "FunctionDefStatement.hpp"
+#include "../Optimizer.hpp"
 
 namespace ast {
 
 class AppendStatement : public Statement {
 public:
-    explicit AppendStatement(Var& from_, Var& to_) : from(from_), to(to_) {}
+    explicit AppendStatement(Slot from_, Slot to_) : from(from_), to(to_) {}
 
-    Return run() override {
-        std::vector<Var> var;
+    // one copy of the whole vector; append(a, a) is fine as well
+    Return run(Frame &frame) const override {
+        const valueVec &source = frame[from].value;
+        frame[to].value.append(source.begin(), source.end());
+        return Return(Return::None);
+    }
+
+    void compile(vm::Compiler &compiler) const override {
+        compiler.emit(vm::OpCode::Append, compiler.variable(to), compiler.variable(from));
+    }
+
+    void writes(Optimizer &opt) const override {
+        opt.write(to);
+    }
 
-        for (auto x : from.value) {
-            to.value.push_back(x);
-        }
-        Return ret(Return::None);
-        return ret;
+    // to is extended, not replaced, so it's read as well
+    void reads(Optimizer &opt) const override {
+        opt.read(from);
+        opt.read(to);
     }
 
 private:
-    Var& from;
-    Var& to;
+    Slot from;
+    Slot to;
 };
 
 }
@@ -4,6 +4,7 @@
 #include "Statement.hpp"
 #include "../expression/Expression.hpp"
 #include "../Var.hpp"
+#include "../Optimizer.hpp"
 
 namespace ast
 {
@@ -11,35 +12,77 @@ namespace ast
 class AssignStatement : public Statement
 {
 public:
-    AssignStatement(Var &var_, std::unique_ptr<Expression> expr_) :
-        var(var_), expr(std::move(expr_)) {}
+    AssignStatement(Slot var_, exprPtr expr_, exprPtr index_ = nullptr) :
+        var(var_), expr(expr_), index(index_) {}
 
-    AssignStatement(Var &var_, std::unique_ptr<Expression> index_, std::unique_ptr<Expression> expr_) : 
-        var(var_), expr(std::move(expr_)), index(std::move(index_)) {
-    }
+    Return run(Frame &frame) const override {
+        if (index == nullptr && expr->assignTo(frame, var))
+            return Return(Return::None);
 
-    Return run() override {
-        Var ret = expr->calculate();
+        Var ret = expr->calculate(frame);
         if (index != nullptr) {
-            Var idx = index->calculate();
+            Var idx = index->calculate(frame);
             if (idx.value[0] >= 0) {
                 if (ret.size() == 1) {
-                    var.at(static_cast<unsigned int>(idx.value[0])) = ret.at(0);
+                    frame[var].at(static_cast<unsigned int>(idx.value[0])) = ret.at(0);
                 } else {
                     throw std::runtime_error("Cannot assign vector to int");
                 }
             }
         } else {
-            var = ret;
+            frame[var] = std::move(ret);
         }
 
         return Return(Return::None);
     }
 
+    void compile(vm::Compiler &compiler) const override {
+        unsigned target = compiler.variable(var);
+        if (index != nullptr) {
+            unsigned value = compiler.operand(*expr);
+            compiler.emit(vm::OpCode::StoreIndex, target, compiler.operand(*index), value);
+        } else {
+            expr->compile(compiler, target);
+        }
+    }
+
+    void optimize(Optimizer &opt) override {
+        expr = expr->optimize(opt);
+        if (index != nullptr)
+            index = index->optimize(opt);
+    }
+
+    void hoist(Optimizer &opt) override {
+        expr = expr->hoist(opt);
+        if (index != nullptr)
+            index = index->hoist(opt);
+    }
+
+    void writes(Optimizer &opt) const override {
+        opt.write(var);
+    }
+
+    // the value of a dead store isn't needed, unless it's an indexed store
+    // or computing it could fail
+    void reads(Optimizer &opt) const override {
+        if (dead(opt))
+            return;
+        if (index != nullptr) {
+            opt.read(var);
+            index->reads(opt);
+        }
+        expr->reads(opt);
+    }
+
+    bool dead(const Optimizer &opt) const override {
+        return index == nullptr && !opt.live(var)
+            && (expr->literalValue() != nullptr || expr->directVariable() != nullptr);
+    }
+
 private:
-    Var& var;
-    std::unique_ptr<Expression> expr;
-    std::unique_ptr<Expression> index;
+    Slot var;
+    exprPtr expr;
+    exprPtr index;
 };
 
 }
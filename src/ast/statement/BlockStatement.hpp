@@ -3,60 +3,167 @@
 
 #include "Statement.hpp"
 #include "../Var.hpp"
-#include <unordered_map>
-#include <list>
+#include "../Error.hpp"
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace ast
 {
-using stmtPtr = std::unique_ptr<Statement>;
+// nodes are owned by the Program's Arena
+using stmtPtr = Statement*;
 
 class BlockStatement : public Statement
 {
 public:
-    BlockStatement(BlockStatement *parent_ = nullptr) : parent(parent_) {}
+    BlockStatement(BlockStatement *parent_ = nullptr)
+        : parent(parent_), top(parent_ ? parent_->top : 0) {}
     
     const BlockStatement* getParent() const { return parent; }
 
-    void addStatement(stmtPtr stmt) { statements.push_back(std::move(stmt)); }
+    void setStatements(Span<stmtPtr> statements_) { statements = statements_; }
 
-    void addVariable(const std::string& id, Var&& var) { variables.insert({id, var}); }
+    // Variables are named by the id of their name in the program's
+    // interner. Slots of a block are released when it ends, so sibling
+    // blocks share them. Every declaration initializes its variable, which
+    // makes it safe.
+    Slot addVariable(unsigned symbol) {
+        Slot slot{top++};
+        variables.emplace_back(symbol, slot);
 
-    bool existVariable(const std::string& id) { 
-        return variables.count(id) || (parent ? parent->existVariable(id) : false);
+        BlockStatement *root = this;
+        while (root->parent) root = root->parent;
+        if (top > root->size) root->size = top;
+
+        return slot;
+    }
+
+    bool existVariable(unsigned symbol) const {
+        for (const BlockStatement *scope = this; scope; scope = scope->parent)
+            for (auto &variable : scope->variables)
+                if (variable.first == symbol)
+                    return true;
+        return false;
+    }
+
+    Slot findVariable(unsigned symbol) const {
+        for (const BlockStatement *scope = this; scope; scope = scope->parent)
+            for (auto &variable : scope->variables)
+                if (variable.first == symbol)
+                    return variable.second;
+        throw std::runtime_error("var not found");
     }
 
-    Var& findVariable(const std::string& id) {
-        if (variables.count(id)) return variables.at(id);
-        else if (parent) return parent->findVariable(id);
-        else throw std::runtime_error("var not found");
+    // the variable in slot gets named by another id, for a body parsed
+    // with an interner of its own
+    void renameVariable(Slot slot, unsigned symbol) {
+        for (auto &variable : variables)
+            if (variable.second.index == slot.index)
+                variable.first = symbol;
     }
 
-    Return run() override {
+    // slot past every variable of the function, only for the root block
+    Slot addTemporary() { return Slot{size++}; }
+
+    // number of slots needed by the frame of the function owning this block
+    unsigned frameSize() const { return size; }
+
+    Return run(Frame &frame) const override {
+        if (Profiler *profiler = frame.context().profiler())
+            return run(frame, *profiler);
+
         Return ret;
-        std::list<Var> oldVariables;
-        for (auto &var : variables) {
-            oldVariables.push_back(var.second);
+        auto stmt = statements.begin();
+
+        try {
+            for (; stmt != statements.end(); ++stmt) {
+                ret = (*stmt)->run(frame);
+                if (ret.type != Return::None)
+                    break;
+            }
+        } catch (std::runtime_error &) {
+            RuntimeError::rethrow((*stmt)->getLine());
+        }
+
+        return ret;
+    };
+
+    Return run(Frame &frame, Profiler &profiler) const {
+        Return ret;
+        auto stmt = statements.begin();
+
+        try {
+            for (; stmt != statements.end(); ++stmt) {
+                profiler.hit((*stmt)->getLine());
+                ret = (*stmt)->run(frame);
+                if (ret.type != Return::None)
+                    break;
+            }
+        } catch (std::runtime_error &) {
+            RuntimeError::rethrow((*stmt)->getLine());
         }
 
-        for (auto &&stmt : statements) {
-            ret = stmt->run();
-            if (ret.type != Return::None)
+        return ret;
+    }
+
+    void compile(vm::Compiler &compiler) const override {
+        for (auto stmt : statements)
+            compiler.statement(*stmt);
+    }
+
+    // statements after a return, break or continue never run
+    void optimize(Optimizer &opt) override {
+        for (unsigned i = 0; i < statements.size(); ++i) {
+            if (statements[i]->terminates()) {
+                statements = Span<stmtPtr>(statements.begin(), i + 1);
                 break;
+            }
         }
+        for (auto stmt : statements)
+            stmt->optimize(opt);
+    }
+
+    void hoist(Optimizer &opt) override {
+        for (auto stmt : statements)
+            stmt->hoist(opt);
+    }
 
-        for (auto &&var : variables) {
-            var.second = oldVariables.front();
-            oldVariables.pop_front();
+    void writes(Optimizer &opt) const override {
+        for (auto stmt : statements)
+            stmt->writes(opt);
+    }
+
+    void reads(Optimizer &opt) const override {
+        for (auto stmt : statements)
+            stmt->reads(opt);
+    }
+
+    // the span is compacted in place, it's owned by this block alone
+    void prune(const Optimizer &opt) override {
+        unsigned kept = 0;
+        for (auto stmt : statements) {
+            if (stmt->dead(opt))
+                continue;
+            stmt->prune(opt);
+            statements[kept++] = stmt;
         }
+        statements = Span<stmtPtr>(statements.begin(), kept);
+    }
 
-        return ret;
-    };
+    bool terminates() const override {
+        for (auto stmt : statements)
+            if (stmt->terminates())
+                return true;
+        return false;
+    }
 
 private:
     BlockStatement* parent;
-    std::list<stmtPtr> statements;
-    std::unordered_map<std::string, Var> variables;
+    Span<stmtPtr> statements;
+    // a block declares a handful at most, a scan beats hashing
+    std::vector<std::pair<unsigned, Slot>> variables;
+    unsigned top;
+    unsigned size = 0;
 };
 
 }
@@ -1,41 +1,161 @@
 #ifndef PARSER_FUNCALLSTATEMENT_HPP_
 #define PARSER_FUNCALLSTATEMENT_HPP_
 
-#include <list>
-#include <memory>
+#include <algorithm>
+#include <string>
+#include <vector>
 #include "Statement.hpp"
 #include "FunctionDefStatement.hpp"
+#include "../Builtin.hpp"
+#include "../Error.hpp"
 #include "../expression/Expression.hpp"
+#include "../Optimizer.hpp"
 
 namespace ast {
 
 class FunctionCall : public Statement {
 public:
-    explicit FunctionCall(FunctionDefinition &functionDef)
-            : functionDef(functionDef) {
+    // the callee is bound right away when it's already known, otherwise
+    // Program::link() binds it by name once every file is parsed
+    explicit FunctionCall(std::string name_)
+            : name(std::move(name_)) {
     }
 
-    void addExpression(std::unique_ptr<Expression> expr) {
-        expressions.push_back(std::move(expr));
+    void bind(FunctionDefinition &functionDef_) {
+        functionDef = &functionDef_;
+        builtin = nullptr;
     }
+    void bind(const Builtin &builtin_) {
+        builtin = &builtin_;
+        functionDef = nullptr;
+    }
+    bool bound() const { return functionDef != nullptr || builtin != nullptr; }
+
+    const std::string& getName() const { return name; }
+    // number of parameters of the bound callee
+    unsigned arity() const { return builtin != nullptr ? builtin->arity : functionDef->size(); }
+
+    void setArguments(Span<exprPtr> expressions_) { expressions = expressions_; }
 
     unsigned size() { return expressions.size(); }
 
-    Return run() override {
-        std::list<Var> var;
-        for (auto &&expr : expressions) {
-            var.push_back(expr->calculate());
+    Return run(Frame &frame) const override {
+        if (!bound())
+            throw std::runtime_error("Function not found: " + name);
+        if (builtin != nullptr) {
+            std::vector<Var> args;
+            args.reserve(expressions.size());
+            for (auto expr : expressions)
+                args.push_back(expr->calculate(frame));
+            if (builtin->blocking)
+                frame.context().budget().pause();
+            Profiler::Scope scope(frame.context().profiler(), name);
+            Stats::Scope stats(name);
+            return Return(Return::None, builtin->native(args.data()));
+        }
+
+        frame.context().budget().step();
+        Frame callee(frame.context(), functionDef->frameSize());
+
+        unsigned slot = 0;
+        for (auto expr : expressions) {
+            callee[Slot{slot++}] = expr->calculate(frame);
+        }
+        Profiler::Scope scope(frame.context().profiler(), name);
+        Stats::Scope stats(name);
+        Var result;
+        if (frame.context().jitEnabled() && functionDef->runNative(callee, result))
+            return Return(Return::None, std::move(result));
+
+        try {
+            Return ret = functionDef->run(callee);
+            ret.type = Return::None;
+            return ret;
+        } catch (RuntimeError &) {
+            RuntimeError::rethrow(0, name);
         }
-        Return ret = functionDef.run(var);
-        ret.type = Return::None;
-        return ret;
+    }
+
+    void compile(vm::Compiler &compiler) const override {
+        compileValue(compiler, compiler.temp());
+    }
+
+    void compileValue(vm::Compiler &compiler, unsigned dst) const override {
+        if (!bound())
+            throw std::runtime_error("Function not found: " + name);
+
+        // arguments have to land in consecutive registers
+        unsigned base = expressions.empty() ? 0 : compiler.temp();
+        for (unsigned i = 1; i < expressions.size(); ++i)
+            compiler.temp();
+
+        unsigned reg = base;
+        for (auto expr : expressions)
+            expr->compile(compiler, reg++);
+
+        if (builtin != nullptr)
+            compiler.emit(vm::OpCode::CallNative, dst, compiler.native(*builtin), base);
+        else
+            compiler.emit(vm::OpCode::Call, dst, compiler.function(*functionDef), base);
+    }
+
+    void optimize(Optimizer &opt) override {
+        for (auto &expr : expressions)
+            expr = expr->optimize(opt);
+    }
+
+    void hoist(Optimizer &opt) override {
+        for (auto &expr : expressions)
+            expr = expr->hoist(opt);
+    }
+
+    // functions can't change the caller's variables, but a builtin like
+    // save() changes what another one returns
+    bool invariant(const Optimizer &opt) const override {
+        std::vector<const FunctionDefinition*> visiting;
+        if (!pure(visiting))
+            return false;
+        for (auto expr : expressions)
+            if (!expr->invariant(opt))
+                return false;
+        return true;
+    }
+
+    void reads(Optimizer &opt) const override {
+        for (auto expr : expressions)
+            expr->reads(opt);
+    }
+
+    bool pure(std::vector<const FunctionDefinition*> &visiting) const {
+        if (builtin != nullptr)
+            return builtin->pure;
+        return functionDef != nullptr && functionDef->pure(visiting);
     }
 
 private:
-    FunctionDefinition &functionDef;
-    std::list<std::unique_ptr<Expression>> expressions;
+    std::string name;
+    FunctionDefinition *functionDef = nullptr;
+    const Builtin *builtin = nullptr;
+    Span<exprPtr> expressions;
 };
 
+inline bool FunctionDefinition::pure(std::vector<const FunctionDefinition*> &visiting) const {
+    if (lazy)
+        return false;
+    if (std::find(visiting.begin(), visiting.end(), this) != visiting.end())
+        return true;
+    visiting.push_back(this);
+    bool result = true;
+    for (auto call : callSites) {
+        if (!call->pure(visiting)) {
+            result = false;
+            break;
+        }
+    }
+    visiting.pop_back();
+    return result;
+}
+
 }
 
 
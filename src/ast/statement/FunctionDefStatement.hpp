@@ -2,47 +2,141 @@
 #define AST_FUNCTIONDEFSTATEMENT_HPP_
 
 #include <string>
-#include <list>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <exception>
 #include "../Var.hpp"
 #include "../VarType.hpp"
 #include "BlockStatement.hpp"
+#include "../../util/Interner.hpp"
+#include "../../vm/Compiler.hpp"
+#include "../../vm/Jit.hpp"
 
 namespace ast
 {
 
+class Program;
+class FunctionCall;
+
 class FunctionDefinition
 {
 public:
     FunctionDefinition(std::string id_) : id(id_) {}
 
-    void addParam(const std::string& id) {
-        vars.push_back(id);
-        block.addVariable(id, Var());
+    // symbol is the id of the name in the program's interner
+    void addParam(const std::string& id, unsigned symbol) {
+        params.push_back(id);
+        block.addVariable(symbol);
+    }
+
+    // names the parameters by their ids in symbols, which parses the body
+    void internParams(util::Interner &symbols) {
+        for (unsigned i = 0; i < params.size(); ++i)
+            block.renameVariable(Slot{i}, symbols.intern(params[i]).id);
     }
     BlockStatement& getFunctionBlock() {
+        ensureParsed();
         return block;
     }
     const std::string& getId() const { return id; }
 
-    unsigned size() { return vars.size(); }
+    unsigned size() const { return params.size(); }
+
+    // calls made in the body, so they can be bound again when the function
+    // they call is replaced, see Program::replace()
+    void addCall(FunctionCall &call) { callSites.push_back(&call); }
+    const std::vector<FunctionCall*>& getCalls() const { return callSites; }
 
-    Return run(std::list<Var> var = std::list<Var>()) {
-        auto itParameters = vars.begin();
-        auto itVar = var.begin();
+    // no call made in the body, directly or through other functions,
+    // reaches a builtin that isn't pure; false while that isn't known,
+    // like for a lazy body, which another thread may be parsing, or a call
+    // not bound yet. visiting holds the functions being looked at, calls
+    // back to them are pure.
+    bool pure(std::vector<const FunctionDefinition*> &visiting) const;
+    unsigned frameSize() const {
+        ensureParsed();
+        return block.frameSize();
+    }
+
+    // parameters take the first slots of the frame, in declaration order
+    Return run(Frame &frame) const {
+        ensureParsed();
+        return block.run(frame);
+    };
 
-        for (; itVar != var.end(); ++itVar, ++itParameters) {
-            block.findVariable(*itParameters) = *itVar;
+    // frame holds the arguments of a call; once the function is hot it's
+    // compiled to native code, which then runs the call when it can. Runs
+    // on other threads may get here at the same time: the counts are only
+    // approximate, and the function is compiled once.
+    bool runNative(Frame &frame, Var &result) const {
+        if (failures.load(std::memory_order_relaxed) >= vm::Jit::maxFailures)
+            return false;
+        if (calls.load(std::memory_order_relaxed) < vm::Jit::hotCalls) {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        std::call_once(compiledFlag, [this] {
+            try {
+                vm::Module module = vm::Compiler().compile(const_cast<FunctionDefinition&>(*this));
+                native = vm::Jit::compile(module);
+                nativeEntry = module.entry;
+            } catch (std::exception &) {
+                // e.g. a call to an unknown function, which fails only if reached
+            }
+        });
+        if (native && native->call(nativeEntry, &frame[Slot{0}], result))
+            return true;
+        failures.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
 
-        Return ret = block.run();
+    // body left unparsed until the function is first used; parse fills
+    // the block, resolving calls against the program owning the function
+    typedef std::function<void(Program&, BlockStatement&)> BodyParser;
+    void setLazyBody(BodyParser parse) {
+        lazyBody = std::move(parse);
+        lazy = true;
+    }
+    void setOwner(Program &program) { owner = &program; }
 
-        return ret;
-    };
+    // a body that fails to parse is left half filled, so it's never run:
+    // the error is kept and thrown again by every later use
+    void ensureParsed() const {
+        if (!lazy)
+            return;
+        std::call_once(parsedFlag, [this] {
+            auto self = const_cast<FunctionDefinition*>(this);
+            try {
+                lazyBody(*owner, self->block);
+            } catch (...) {
+                parseError = std::current_exception();
+            }
+            self->lazyBody = nullptr;
+        });
+        if (parseError)
+            std::rethrow_exception(parseError);
+    }
 
 private:
     std::string id;
-    std::list<std::string> vars;
+    std::vector<std::string> params;
     BlockStatement block;
+    std::vector<FunctionCall*> callSites;
+
+    Program *owner = nullptr;
+
+    // native code is a cache, the function doesn't change by getting it
+    mutable std::atomic<unsigned> calls{0};
+    mutable std::atomic<unsigned> failures{0};
+    mutable std::once_flag compiledFlag;
+    mutable std::unique_ptr<vm::Jit> native;
+    mutable unsigned nativeEntry = 0;
+    BodyParser lazyBody;
+    bool lazy = false;
+    mutable std::once_flag parsedFlag;
+    mutable std::exception_ptr parseError;
 };
 
 }
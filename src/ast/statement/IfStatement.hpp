@@ -8,33 +8,79 @@
 namespace ast
 {
 
-using stmtBlockPtr = std::unique_ptr<BlockStatement>;
+using stmtBlockPtr = BlockStatement*;
 
 class IfStatement : public Statement
 {
 public:
-    IfStatement (std::unique_ptr<Expression> expr_, stmtBlockPtr ifBlock_) 
-        : expr(std::move(expr_)), ifBlock(std::move(ifBlock_)) {}
+    IfStatement (exprPtr expr_, stmtBlockPtr ifBlock_, stmtBlockPtr elseBlock_ = nullptr) 
+        : expr(expr_), ifBlock(ifBlock_), elseBlock(elseBlock_) {}
 
-    IfStatement (std::unique_ptr<Expression> expr_, stmtBlockPtr ifBlock_, stmtBlockPtr elseBlock_) 
-        : IfStatement(std::move(expr_), std::move(ifBlock_)) {
-        elseBlock = std::move(elseBlock_);
-    }
-
-    Return run() override {
-        if (expr->calculate()) {
-            return ifBlock->run();
+    Return run(Frame &frame) const override {
+        if (expr->calculate(frame)) {
+            return ifBlock->run(frame);
         } else {
             if (elseBlock != nullptr) {
-                return elseBlock->run();
+                return elseBlock->run(frame);
             } else {
                 return Return(Return::None);
             }
         }
     }
 
+    void compile(vm::Compiler &compiler) const override {
+        size_t toElse = compiler.emit(vm::OpCode::JumpIfFalse, compiler.operand(*expr));
+        compiler.statement(*ifBlock);
+
+        if (elseBlock != nullptr) {
+            size_t toEnd = compiler.emit(vm::OpCode::Jump);
+            compiler.patch(toElse, compiler.label());
+            compiler.statement(*elseBlock);
+            compiler.patch(toEnd, compiler.label());
+        } else {
+            compiler.patch(toElse, compiler.label());
+        }
+    }
+
+    void optimize(Optimizer &opt) override {
+        expr = expr->optimize(opt);
+        ifBlock->optimize(opt);
+        if (elseBlock != nullptr)
+            elseBlock->optimize(opt);
+    }
+
+    void hoist(Optimizer &opt) override {
+        expr = expr->hoist(opt);
+        ifBlock->hoist(opt);
+        if (elseBlock != nullptr)
+            elseBlock->hoist(opt);
+    }
+
+    void writes(Optimizer &opt) const override {
+        ifBlock->writes(opt);
+        if (elseBlock != nullptr)
+            elseBlock->writes(opt);
+    }
+
+    void reads(Optimizer &opt) const override {
+        expr->reads(opt);
+        ifBlock->reads(opt);
+        if (elseBlock != nullptr)
+            elseBlock->reads(opt);
+    }
+
+    void prune(const Optimizer &opt) override {
+        ifBlock->prune(opt);
+        if (elseBlock != nullptr)
+            elseBlock->prune(opt);
+    }
+
+    bool terminates() const override {
+        return elseBlock != nullptr && ifBlock->terminates() && elseBlock->terminates();
+    }
+
 private:
-    std::unique_ptr<Expression> expr;
+    exprPtr expr;
     stmtBlockPtr ifBlock;
     stmtBlockPtr elseBlock;
 };
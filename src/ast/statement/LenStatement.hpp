@@ -6,21 +6,34 @@
 #include "Statement.hpp"
 #include "../expression/Expression.hpp"
 #include "FunctionDefStatement.hpp"
+#include "../Optimizer.hpp"
 
 namespace ast {
 
 class LenStatement : public Statement {
 public:
-    explicit LenStatement(Var& var_) : var(var_) {}
+    explicit LenStatement(Slot var_) : var(var_) {}
 
-    Return run() override {
-        int size = var.value.size();
+    Return run(Frame &frame) const override {
+        int size = frame[var].value.size();
         Var var(VarType::INT, valueVec({size}));
         return Return(Return::None, var);
     }
 
+    void compileValue(vm::Compiler &compiler, unsigned dst) const override {
+        compiler.emit(vm::OpCode::Len, dst, compiler.variable(var));
+    }
+
+    bool invariant(const Optimizer &opt) const override {
+        return !opt.written(var);
+    }
+
+    void reads(Optimizer &opt) const override {
+        opt.read(var);
+    }
+
 private:
-    Var& var;
+    Slot var;
 };
 
 }
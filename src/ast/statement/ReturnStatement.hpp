@@ -1,7 +1,6 @@
 #ifndef PARSER_RETURNSTATEMENT_HPP_
 #define PARSER_RETURNSTATEMENT_HPP_
 
-#include <memory>
 #include "Statement.hpp"
 #include "../expression/Expression.hpp"
 
@@ -9,22 +8,48 @@ namespace ast {
 
 class ReturnStatement : public Statement {
 public:
-    explicit ReturnStatement(std::unique_ptr<Expression> expression)
-            : expr(std::move(expression)) {
+    explicit ReturnStatement(exprPtr expression)
+            : expr(expression) {
     }
     explicit ReturnStatement(Return::Type type)
             : return_(type) {}
 
-    Return run() override {
+    Return run(Frame &frame) const override {
         if(expr != nullptr) {
-            return Return(Return::Variable, expr->calculate());
+            return Return(Return::Variable, expr->calculate(frame));
         } else {
             return Return(return_);
         }
     }
 
+    void compile(vm::Compiler &compiler) const override {
+        if (expr != nullptr)
+            compiler.emit(vm::OpCode::Return, compiler.operand(*expr));
+        else if (return_ == Return::Break)
+            compiler.emitBreak();
+        else if (return_ == Return::Continue)
+            compiler.emitContinue();
+    }
+
+    void optimize(Optimizer &opt) override {
+        if (expr != nullptr)
+            expr = expr->optimize(opt);
+    }
+
+    void hoist(Optimizer &opt) override {
+        if (expr != nullptr)
+            expr = expr->hoist(opt);
+    }
+
+    void reads(Optimizer &opt) const override {
+        if (expr != nullptr)
+            expr->reads(opt);
+    }
+
+    bool terminates() const override { return true; }
+
 private:
-    std::unique_ptr<Expression> expr;
+    exprPtr expr = nullptr;
     Return::Type return_ = Return::None;
 };
 
@@ -1,18 +1,51 @@
 #ifndef AST_STATEMENT_HPP_
 #define AST_STATEMENT_HPP_
 
-#include <memory>
+#include <stdexcept>
+#include "../Arena.hpp"
 #include "../Return.hpp"
+#include "../Frame.hpp"
+#include "../../vm/Compiler.hpp"
 
 namespace ast
 {
 
+class Optimizer;
+
 class Statement 
 {
 public:
     virtual ~Statement() = default;
 
-    virtual Return run() { return Return(Return::None); }
+    virtual Return run(Frame &) const { return Return(Return::None); }
+    virtual void compile(vm::Compiler &) const {}
+    // for statements yielding a value (calls, len), emits code storing it in dst
+    virtual void compileValue(vm::Compiler &, unsigned) const {
+        throw std::runtime_error("Statement has no value");
+    }
+
+    // see Optimizer
+    virtual void optimize(Optimizer &) {}
+    virtual void hoist(Optimizer &) {}
+    // marks the slots the statement assigns
+    virtual void writes(Optimizer &) const {}
+    // for statements yielding a value, whether it's loop invariant
+    virtual bool invariant(const Optimizer &) const { return false; }
+    // marks the slots the statement reads, see Optimizer::live()
+    virtual void reads(Optimizer &) const {}
+    // a store nothing reads, which can be dropped
+    virtual bool dead(const Optimizer &) const { return false; }
+    // drops dead statements of nested blocks
+    virtual void prune(const Optimizer &) {}
+    // control never gets past the statement
+    virtual bool terminates() const { return false; }
+
+    // source line the statement starts at, for the Profiler
+    void setLine(int line_) { line = line_; }
+    int getLine() const { return line; }
+
+private:
+    int line = 0;
 };
 
 }
@@ -3,24 +3,27 @@
 
 #include "Statement.hpp"
 #include "BlockStatement.hpp"
+#include "../Optimizer.hpp"
 
 namespace ast
 {
 
-using stmtBlockPtr = std::unique_ptr<BlockStatement>;
+using stmtBlockPtr = BlockStatement*;
 
 class WhileStatement : public Statement
 {
 public:
-    WhileStatement (std::unique_ptr<Expression> expr_, stmtBlockPtr whileBlock_) 
-    : expr(std::move(expr_)), whileBlock(std::move(whileBlock_)) {}
+    WhileStatement (exprPtr expr_, stmtBlockPtr whileBlock_) 
+    : expr(expr_), whileBlock(whileBlock_) {}
 
-    Return run() override {
+    Return run(Frame &frame) const override {
         Return ret;
-        unsigned int maxLoops = 1000000;
+        Budget &budget = frame.context().budget();
+        for (auto flag : cached)
+            frame[flag] = Var();
 
-        while (expr->calculate() && --maxLoops > 0) {
-            ret = whileBlock->run();
+        while (expr->calculate(frame)) {
+            ret = whileBlock->run(frame);
 
             switch (ret.type) {
                 case Return::Break:
@@ -30,19 +33,62 @@ public:
                     return ret;
 
                 default:
+                    budget.step();
                     continue;
             }
         }
-        if (maxLoops <= 0)
-            throw std::runtime_error("Time out in WhileStatement");
-        else {
-            return Return(Return::None);
-        }
+        return Return(Return::None);
+    }
+
+    void compile(vm::Compiler &compiler) const override {
+        for (auto flag : cached)
+            compiler.emit(vm::OpCode::LoadConst, compiler.variable(flag), compiler.constant(Var()));
+
+        size_t top = compiler.label();
+        size_t toEnd = compiler.emit(vm::OpCode::JumpIfFalse, compiler.operand(*expr));
+
+        compiler.beginLoop(top);
+        compiler.statement(*whileBlock);
+        compiler.emit(vm::OpCode::Jump, 0, top);
+
+        compiler.patch(toEnd, compiler.label());
+        compiler.endLoop(compiler.label());
+    }
+
+    // nested loops are done first, their cached expressions stay theirs
+    void optimize(Optimizer &opt) override {
+        expr = expr->optimize(opt);
+        whileBlock->optimize(opt);
+
+        opt.beginLoop();
+        whileBlock->writes(opt);
+        expr = expr->hoist(opt);
+        whileBlock->hoist(opt);
+        cached = opt.endLoop();
+    }
+
+    void hoist(Optimizer &opt) override {
+        expr = expr->hoist(opt);
+        whileBlock->hoist(opt);
+    }
+
+    void writes(Optimizer &opt) const override {
+        whileBlock->writes(opt);
+    }
+
+    void reads(Optimizer &opt) const override {
+        expr->reads(opt);
+        whileBlock->reads(opt);
+    }
+
+    void prune(const Optimizer &opt) override {
+        whileBlock->prune(opt);
     }
 
 private:
-    std::unique_ptr<Expression> expr; 
+    exprPtr expr;
     stmtBlockPtr whileBlock;
+    Span<Slot> cached;
 };
 
 }
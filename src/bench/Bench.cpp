@@ -0,0 +1,290 @@
+#define BOOST_LOG_DYN_LINK 1
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../scanner/Scanner.hpp"
+#include "../scanner/TokenTypeWrapper.hpp"
+#include "../parser/Parser.hpp"
+#include "../reader/Reader.hpp"
+#include "../std/Std.hpp"
+#include "../std/VectorFile.hpp"
+#include "../ast/Var.hpp"
+#include "../ast/Stats.hpp"
+#include "../vm/Compiler.hpp"
+#include "../vm/VM.hpp"
+#include "../engine/Engine.hpp"
+
+// Hot paths of the interpreter, run with Google Benchmark. Every benchmark
+// builds its input outside the timed loop; sizes go from a handful of
+// values up to a million. --benchmark_format=json (or --benchmark_out=FILE
+// --benchmark_out_format=json) gives results that can be compared between
+// versions, e.g. with Google Benchmark's tools/compare.py.
+
+using namespace scanner;
+using namespace parser;
+using namespace stdlibrary;
+
+namespace
+{
+
+// identifiers are letters only; no keyword starts with g
+std::string name(unsigned i) {
+    std::string id = "g";
+    do {
+        id += static_cast<char>('a' + i % 26);
+        i /= 26;
+    } while (i > 0);
+    return id;
+}
+
+// count functions with a loop, a call and vector arithmetic each; about
+// 200 bytes a function
+std::string generateSource(unsigned count) {
+    std::string source;
+    for (unsigned i = 0; i < count; ++i) {
+        std::string id = std::to_string(i);
+        source += "fun " + name(i) + "(a, b) {\n"
+                  "    var v = [1, 2, 3, " + id + "];\n"
+                  "    var i = 0;\n"
+                  "    while (i < len(v) && a != b) {\n"
+                  "        v[i] = v[i] * 2 + a - b / 3;\n"
+                  "        i = i + 1;\n"
+                  "    }\n"
+                  "    return sort(v);\n"
+                  "}\n";
+    }
+    source += "fun main() {\n    return " + name(0) + "(1, 2);\n}\n";
+    return source;
+}
+
+std::unique_ptr<Parser> parseSource(const std::string &source) {
+    auto parser = std::make_unique<Parser>();
+    Std stdlib(*parser);
+    parser->setScr(std::make_unique<Scanner>(std::make_unique<Reader>(source.data(), source.size())));
+    parser->parse();
+    parser->getProgram().link();
+    return parser;
+}
+
+valueVec randomValues(unsigned size, int range) {
+    std::mt19937 random(size);
+    std::uniform_int_distribution<int> values(0, range - 1);
+    valueVec result(size);
+    for (auto &value : result)
+        value = values(random);
+    return result;
+}
+
+// main returning result, an expression of a, which is size random digits
+std::string vectorSource(unsigned size, const std::string &result) {
+    std::string literal;
+    for (auto value : randomValues(size, 10)) {
+        if (!literal.empty())
+            literal += ", ";
+        literal += std::to_string(value);
+    }
+    return "fun main() {\n    var a = [" + literal + "];\n    return " + result + ";\n}\n";
+}
+
+void scan(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = generateSource(state.range(0));
+    for (auto _ : state) {
+        Scanner scanner(std::make_unique<Reader>(source.data(), source.size()));
+        unsigned tokens = 0;
+        while (scanner.scan().getType() != TokenType::T_EOF)
+            ++tokens;
+        benchmark::DoNotOptimize(tokens);
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK(scan)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void parse(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = generateSource(state.range(0));
+    std::size_t arena = 0;
+    std::uint64_t heap = 0;
+    for (auto _ : state) {
+        ast::Stats stats;
+        stats.attach();
+        auto parser = parseSource(source);
+        arena = parser->getProgram().getArena().reserved();
+        heap = stats.total().heapBytes;
+        benchmark::DoNotOptimize(parser.get());
+    }
+    state.SetBytesProcessed(state.iterations() * source.size());
+    state.counters["arena_bytes"] = arena;
+    state.counters["vector_bytes"] = heap;
+}
+BENCHMARK(parse)->RangeMultiplier(8)->Range(8, 1 << 15);
+
+void addVectors(benchmark::State &state) {
+    Var a(VarType::INT, randomValues(state.range(0), 1000));
+    Var b(VarType::INT, randomValues(state.range(0), 1000));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a + b);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(addVectors)->RangeMultiplier(8)->Range(1, 1 << 20);
+
+void scaleVector(benchmark::State &state) {
+    Var a(VarType::INT, randomValues(state.range(0), 1000));
+    Var k(VarType::INT, valueVec({3}));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(a * k);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(scaleVector)->RangeMultiplier(8)->Range(1, 1 << 20);
+
+void addInPlace(benchmark::State &state) {
+    Var a(VarType::INT, randomValues(state.range(0), 1000));
+    Var b(VarType::INT, randomValues(state.range(0), 1000));
+    for (auto _ : state) {
+        a += b;
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(addInPlace)->RangeMultiplier(8)->Range(1, 1 << 20);
+
+void sortFilterVm(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = vectorSource(state.range(0), "sort(filter(a, 5, 1))");
+    auto parser = parseSource(source);
+    vm::Module module = vm::Compiler().compile(parser->getProgram());
+    vm::VM machine;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(machine.run(module));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(sortFilterVm)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kMicrosecond);
+
+void sortFilterTree(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = vectorSource(state.range(0), "sort(filter(a, 5, 1))");
+    auto parser = parseSource(source);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(parser->getProgram().run());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(sortFilterTree)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kMicrosecond);
+
+// a counting loop on scalars only, run with the Int opcodes
+void countLoopVm(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = "fun main() {\n    var i = 0;\n    var s = 0;\n"
+                         "    while (i < " + std::to_string(state.range(0)) + ") {\n"
+                         "        s = s + i * 3 / 2;\n        i = i + 1;\n    }\n    return s;\n}\n";
+    auto parser = parseSource(source);
+    vm::Module module = vm::Compiler().compile(parser->getProgram());
+    vm::VM machine;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(machine.run(module));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(countLoopVm)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kMicrosecond);
+
+// the data parallel builtins, which split big vectors over the threads
+void reduceVm(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    std::string source = vectorSource(state.range(0), "sum(map(keep(a, 4, 1), 3, 1)) + max(a) + count(a, 7, 0)");
+    auto parser = parseSource(source);
+    vm::Module module = vm::Compiler().compile(parser->getProgram());
+    vm::VM machine;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(machine.run(module));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(reduceVm)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kMicrosecond);
+
+// a vector file mapped and summed, against the same values parsed from a
+// literal by sortFilterVm and friends
+void loadVectorFile(benchmark::State &state) {
+    std::string path = "scr_bench.vec";
+    storeVector(randomValues(state.range(0), 1000), path);
+    for (auto _ : state) {
+        Var v(VarType::LIST, loadVector(path));
+        possibleValue sum = 0;
+        for (auto value : static_cast<const valueVec&>(v.value))
+            sum += value;
+        benchmark::DoNotOptimize(sum);
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(loadVectorFile)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kMicrosecond);
+
+// a host running a small script per request: parsing and compiling it
+// every time, or once into a Script that's run with new arguments
+const char *requestSource = "fun main(v, k) {\n    return sort(filter(v * k, 5, 1));\n}\n";
+
+void compileAndRun(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    Var v(VarType::INT, randomValues(16, 10));
+    for (auto _ : state) {
+        auto script = engine::Script::fromSource(requestSource);
+        benchmark::DoNotOptimize(script->run({v, Var(VarType::INT, valueVec({2}))}));
+    }
+}
+BENCHMARK(compileAndRun);
+
+void runCompiled(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    Var v(VarType::INT, randomValues(16, 10));
+    auto script = engine::Script::fromSource(requestSource);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(script->run({v, Var(VarType::INT, valueVec({2}))}));
+}
+BENCHMARK(runCompiled);
+
+// one compiled script or parsed program run by several threads at once;
+// with real time, throughput should grow with the threads
+void runSharedScript(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    static std::shared_ptr<const engine::Script> script = engine::Script::fromSource(requestSource);
+    Var v(VarType::INT, randomValues(16, 10));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(script->run({v, Var(VarType::INT, valueVec({2}))}));
+}
+BENCHMARK(runSharedScript)->ThreadRange(1, 8)->UseRealTime();
+
+void runSharedProgram(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    static std::unique_ptr<Parser> parser = parseSource(vectorSource(1000, "sort(filter(a, 5, 1))"));
+    const ast::Program &program = parser->getProgram();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(program.run());
+}
+BENCHMARK(runSharedProgram)->ThreadRange(1, 8)->UseRealTime();
+
+// the same script over a thousand inputs, on as many threads as there are
+// cores
+void runBatch(benchmark::State &state) {
+    TokenTypeWrapper::getInstance();
+    auto script = engine::Script::fromSource("fun main(v) {\n    return sort(filter(v, 5, 1));\n}\n");
+    std::vector<Var> inputs;
+    for (unsigned i = 0; i < 1000; ++i)
+        inputs.emplace_back(VarType::INT, randomValues(state.range(0) + i % 7, 10));
+    for (auto _ : state) {
+        size_t next = 0;
+        script->runBatch([&inputs, &next](Var &var) {
+            if (next == inputs.size())
+                return false;
+            var = inputs[next++];
+            return true;
+        }, [](const engine::BatchResult &result) {
+            benchmark::DoNotOptimize(result.value);
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * inputs.size());
+}
+BENCHMARK(runBatch)->Arg(16)->Arg(1000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
+
+BENCHMARK_MAIN();
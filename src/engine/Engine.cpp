@@ -0,0 +1,352 @@
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <boost/coroutine2/coroutine.hpp>
+#include <boost/coroutine2/protected_fixedsize_stack.hpp>
+#include "../parser/Parser.hpp"
+#include "../std/Std.hpp"
+#include "../vm/Compiler.hpp"
+#include "../vm/VM.hpp"
+#include "../util/ThreadPool.hpp"
+
+using namespace engine;
+using namespace parser;
+using namespace stdlibrary;
+
+std::vector<std::string> engine::parseSources(std::vector<std::unique_ptr<Reader>> readers, ast::Program &program,
+                                              bool lazy, bool optimize) {
+    auto parseOne = [&readers, lazy, optimize](size_t i) {
+        auto parser = std::make_unique<Parser>();
+        Std stdlib(*parser);
+        parser->parseBodiesLazily(lazy && readers[i]->inMemory());
+        parser->optimize(optimize);
+        parser->setScr(std::make_unique<Scanner>(std::move(readers[i])));
+        std::string error;
+        try {
+            parser->parse();
+        } catch (std::exception &e) {
+            error = e.what();
+        }
+        return std::make_pair(std::move(parser), error);
+    };
+
+    std::vector<std::pair<std::unique_ptr<Parser>, std::string>> results;
+    if (readers.size() == 1) {
+        results.push_back(parseOne(0));
+    } else {
+        unsigned threads = std::min<size_t>(readers.size(), std::max(1u, std::thread::hardware_concurrency()));
+        util::ThreadPool pool(threads);
+        std::vector<std::future<std::pair<std::unique_ptr<Parser>, std::string>>> pending;
+        for (size_t i = 0; i < readers.size(); ++i)
+            pending.push_back(pool.submit([&parseOne, i] { return parseOne(i); }));
+        for (auto &result : pending)
+            results.push_back(result.get());
+    }
+
+    std::vector<std::string> errors;
+    for (auto &result : results) {
+        errors.push_back(result.second);
+        try {
+            program.merge(std::move(result.first->getProgram()));
+        } catch (std::exception &e) {
+            if (errors.back().empty())
+                errors.back() = e.what();
+        }
+    }
+    return errors;
+}
+
+std::shared_ptr<const Script> Script::fromFiles(const std::vector<std::string> &paths, const Options &options) {
+    std::shared_ptr<Script> script(new Script(options));
+
+    // every body is compiled up front, so nothing is parsed lazily and the
+    // files don't have to outlive the script
+    std::vector<std::unique_ptr<SourceFile>> sources;
+    std::vector<std::unique_ptr<Reader>> readers;
+    for (auto &path : paths) {
+        sources.push_back(std::make_unique<SourceFile>(path));
+        if (!sources.back()->good())
+            throw std::runtime_error(path + ": cannot open");
+        readers.push_back(sources.back()->reader());
+    }
+    script->build(std::move(readers), paths);
+    return script;
+}
+
+std::shared_ptr<const Script> Script::fromSource(std::string source, const Options &options) {
+    std::shared_ptr<Script> script(new Script(options));
+    std::vector<std::unique_ptr<Reader>> readers;
+    readers.push_back(std::make_unique<Reader>(source.data(), source.size()));
+    script->build(std::move(readers), {""});
+    return script;
+}
+
+void Script::build(std::vector<std::unique_ptr<Reader>> readers, const std::vector<std::string> &names) {
+    Std stdlib(program);
+    std::vector<std::string> errors = parseSources(std::move(readers), program, false, options.optimize);
+
+    std::string message;
+    for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i].empty())
+            continue;
+        if (!message.empty())
+            message += "\n";
+        message += names[i].empty() ? errors[i] : names[i] + ": " + errors[i];
+    }
+    if (!message.empty())
+        throw std::runtime_error(message);
+
+    program.link();
+    compiled = vm::Compiler().compile(program);
+}
+
+ast::Var Script::run(std::vector<ast::Var> args) const {
+    return run(std::move(args), options.budget);
+}
+
+ast::Var Script::run(std::vector<ast::Var> args, const ast::Budget &budget) const {
+    vm::VM machine;
+    machine.enableJit(options.jit);
+    machine.setBudget(budget);
+    return machine.run(compiled, std::move(args));
+}
+
+RunResult Script::tryRun(std::vector<ast::Var> args) const {
+    return tryRun(std::move(args), options.budget);
+}
+
+RunResult Script::tryRun(std::vector<ast::Var> args, const ast::Budget &budget) const {
+    RunResult result;
+    try {
+        result.value = run(std::move(args), budget);
+    } catch (ast::RuntimeError &e) {
+        result.error = e.what();
+        result.line = e.line();
+        result.function = e.function();
+    } catch (std::exception &e) {
+        result.error = e.what();
+    }
+    return result;
+}
+
+size_t Script::runBatch(const BatchInput &next, const BatchOutput &output, unsigned threads) const {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    util::ThreadPool pool(threads);
+
+    std::deque<std::future<BatchResult>> pending;
+    auto flush = [&pending, &output](size_t keep) {
+        while (pending.size() > keep) {
+            output(pending.front().get());
+            pending.pop_front();
+        }
+    };
+
+    size_t count = 0;
+    try {
+        ast::Var input;
+        while (next(input)) {
+            pending.push_back(pool.submit([this, index = count, input = std::move(input)] {
+                RunResult run = tryRun({input});
+                return BatchResult{index, std::move(run.value), std::move(run.error)};
+            }));
+            ++count;
+            flush(threads * 4);
+        }
+    } catch (...) {
+        flush(0);
+        throw;
+    }
+    flush(0);
+    return count;
+}
+
+BatchInput engine::textInput(std::istream &in) {
+    return [&in, line = size_t(0)](ast::Var &var) mutable {
+        std::string text;
+        if (!std::getline(in, text))
+            return false;
+        ++line;
+
+        ast::ValueVec values;
+        const char *at = text.c_str();
+        while (true) {
+            while (*at == ' ' || *at == '\t' || *at == ',' || *at == '\r')
+                ++at;
+            if (*at == '\0')
+                break;
+            char *end;
+            errno = 0;
+            long value = std::strtol(at, &end, 10);
+            if (end == at || errno == ERANGE || value < std::numeric_limits<possibleValue>::min()
+                || value > std::numeric_limits<possibleValue>::max())
+                throw std::runtime_error("Batch input line " + std::to_string(line) + ": expected an integer");
+            values.push_back(static_cast<possibleValue>(value));
+            at = end;
+        }
+        var = ast::Var(VarType::INT, std::move(values));
+        return true;
+    };
+}
+
+BatchInput engine::binaryInput(std::istream &in) {
+    return [&in](ast::Var &var) {
+        std::uint32_t count;
+        if (!in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+            if (in.gcount() != 0)
+                throw std::runtime_error("Batch input cut off");
+            return false;
+        }
+        // grown as elements arrive, at most doubling, so a count larger than
+        // what follows can't allocate more than the input holds
+        ast::ValueVec values;
+        for (std::uint32_t done = 0; done < count;) {
+            std::uint32_t piece = std::min(count - done, std::max(done, std::uint32_t(1) << 16));
+            values.resizeUninitialized(done + piece);
+            if (!in.read(reinterpret_cast<char*>(values.data() + done), std::streamsize(piece) * sizeof(std::int32_t)))
+                throw std::runtime_error("Batch input cut off");
+            done += piece;
+        }
+        var = ast::Var(VarType::INT, std::move(values));
+        return true;
+    };
+}
+
+namespace
+{
+
+typedef boost::coroutines2::coroutine<void> Coro;
+
+}
+
+struct Task::Coroutine {
+    template <typename Body>
+    explicit Coroutine(Body body)
+        : run(boost::coroutines2::protected_fixedsize_stack(Task::stackSize), std::move(body)) {}
+
+    Coro::push_type run;
+};
+
+std::unique_ptr<Task> Script::start(std::vector<ast::Var> args, unsigned steps) const {
+    return std::unique_ptr<Task>(new Task(*this, std::move(args), steps));
+}
+
+Task::Task(const Script &script, std::vector<ast::Var> args, unsigned steps) {
+    // the task doesn't move, so the run can write its outcome in place
+    coroutine = std::make_unique<Coroutine>([this, &script, args = std::move(args), steps](Coro::pull_type &suspend) mutable {
+        ast::Budget budget = script.options.budget;
+        budget.yieldEvery(steps, [&suspend] { suspend(); });
+        outcome = script.tryRun(std::move(args), budget);
+    });
+}
+
+// an unfinished run is unwound on its own stack, freeing what it holds
+Task::~Task() = default;
+
+bool Task::resume() {
+    if (finished)
+        return false;
+    coroutine->run();
+    if (!coroutine->run) {
+        finished = true;
+        coroutine.reset();
+    }
+    return !finished;
+}
+
+Session::Session(const Options &options_) : options(options_) {
+    Std stdlib(program);
+}
+
+void Session::update(std::string source) {
+    parsed.clear();
+    if (source == text)
+        return;
+
+    // the edit spans [first, text.size() - last) of the old text
+    size_t common = std::min(text.size(), source.size());
+    size_t first = 0;
+    while (first < common && text[first] == source[first])
+        ++first;
+    size_t last = 0;
+    while (last < common - first && text[text.size() - 1 - last] == source[source.size() - 1 - last])
+        ++last;
+    size_t end = text.size() - last;
+
+    // functions ending before the edit, or starting after it, are kept; at
+    // least a character away, so none of their tokens can run into it
+    auto functionEnd = [this](size_t i) {
+        return i + 1 < functions.size() ? functions[i + 1].begin : text.size();
+    };
+    size_t keptBefore = 0;
+    while (keptBefore < functions.size() && functionEnd(keptBefore) < first)
+        ++keptBefore;
+    size_t keptAfter = functions.size();
+    while (keptAfter > keptBefore && functions[keptAfter - 1].begin > end)
+        --keptAfter;
+
+    // a kept function calling into the parsed ones, directly or through
+    // others, may have hoisted such a call out of a loop because the old
+    // callee was pure; it's parsed again too, with all in between
+    if (options.optimize) {
+        auto callsParsed = [this, &keptBefore, &keptAfter](size_t i) {
+            for (auto call : program.findFunction(functions[i].id).getCalls())
+                for (size_t j = keptBefore; j < keptAfter; ++j)
+                    if (call->getName() == functions[j].id)
+                        return true;
+            return false;
+        };
+        for (bool grown = keptBefore < keptAfter; grown;) {
+            grown = false;
+            for (size_t i = 0; i < functions.size(); ++i) {
+                if ((i < keptBefore || i >= keptAfter) && callsParsed(i)) {
+                    keptBefore = std::min(keptBefore, i);
+                    keptAfter = std::max(keptAfter, i + 1);
+                    grown = true;
+                }
+            }
+        }
+    }
+
+    // everything in between is parsed again, from where it now is
+    std::ptrdiff_t shift = std::ptrdiff_t(source.size()) - std::ptrdiff_t(text.size());
+    size_t from = keptBefore > 0 ? functionEnd(keptBefore - 1) : 0;
+    size_t to = (keptAfter < functions.size() ? functions[keptAfter].begin : text.size()) + shift;
+
+    int line = 1 + std::count(source.begin(), source.begin() + from, '\n');
+    size_t lineBreak = from > 0 ? source.rfind('\n', from - 1) : std::string::npos;
+    int pos = lineBreak == std::string::npos ? from : from - lineBreak - 1;
+    auto scanner = std::make_unique<Scanner>(std::make_unique<Reader>(source.data() + from, to - from));
+    scanner->startAt(line, pos);
+    Parser parser(std::move(scanner));
+    parser.optimize(options.optimize);
+    parser.parse();
+
+    std::vector<std::string> removed;
+    for (size_t i = keptBefore; i < keptAfter; ++i)
+        removed.push_back(functions[i].id);
+    program.replace(removed, std::move(parser.getProgram()));
+
+    std::vector<Function> updated(functions.begin(), functions.begin() + keptBefore);
+    for (auto &start : parser.functionStarts()) {
+        updated.push_back(Function{start.id, size_t(start.begin - source.data())});
+        parsed.push_back(start.id);
+    }
+    for (size_t i = keptAfter; i < functions.size(); ++i)
+        updated.push_back(Function{functions[i].id, functions[i].begin + shift});
+    functions = std::move(updated);
+    text = std::move(source);
+}
+
+ast::Var Session::run() const {
+    return program.run(false, options.budget).variable;
+}
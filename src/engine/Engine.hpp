@@ -0,0 +1,202 @@
+#ifndef ENGINE_ENGINE_HPP_
+#define ENGINE_ENGINE_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../ast/Program.hpp"
+#include "../ast/Budget.hpp"
+#include "../ast/Error.hpp"
+#include "../ast/Var.hpp"
+#include "../reader/Reader.hpp"
+#include "../vm/Bytecode.hpp"
+
+// Library entry point for hosts running scripts in their own process. A
+// Script is scanned, parsed, linked and compiled once; after that it never
+// changes, so one instance can be kept around and shared, and every run()
+// only pays for running it.
+namespace engine
+{
+
+struct Options {
+    // see Parser::optimize()
+    bool optimize = true;
+    // hot functions and loops run as native code, see vm::Jit
+    bool jit = false;
+    // limits of every single run
+    ast::Budget budget;
+};
+
+// Parses every source with a Parser of its own, on a thread pool when
+// there's more than one, and merges their programs into program in order.
+// Calls between sources are left for Program::link(); bodies are parsed
+// lazily, when asked for, only for in-memory readers. Returns an error
+// message per source, empty for those parsed fine; whatever was parsed
+// before an error is still merged.
+std::vector<std::string> parseSources(std::vector<std::unique_ptr<Reader>> readers, ast::Program &program,
+                                      bool lazy, bool optimize);
+
+// what main returned, or why it failed
+struct RunResult {
+    ast::Var value;
+    // empty when the run succeeded
+    std::string error;
+    // where a runtime error happened; 0 and empty when that isn't known,
+    // e.g. for main getting the wrong number of arguments
+    int line = 0;
+    std::string function;
+
+    explicit operator bool() const { return error.empty(); }
+};
+
+// what main returned for the input at index, or why it failed
+struct BatchResult {
+    size_t index;
+    ast::Var value;
+    std::string error;
+};
+
+// stores the next input of a batch in var; false once there are no more
+typedef std::function<bool(ast::Var &var)> BatchInput;
+typedef std::function<void(const BatchResult &result)> BatchOutput;
+
+// one vector per line, integers separated by spaces or commas; an empty
+// line is an empty vector. Throws on anything else, naming the line.
+BatchInput textInput(std::istream &in);
+// records of a little-endian uint32 count followed by that many int32
+// values, up to the end of in; a cut off record throws
+BatchInput binaryInput(std::istream &in);
+
+class Task;
+
+class Script
+{
+public:
+    // the standard library is registered in every script; a source that
+    // fails to parse or link throws, naming the file for fromFiles
+    static std::shared_ptr<const Script> fromFiles(const std::vector<std::string> &paths,
+                                                   const Options &options = Options());
+    static std::shared_ptr<const Script> fromSource(std::string source, const Options &options = Options());
+
+    Script(const Script&) = delete;
+    Script& operator=(const Script&) = delete;
+
+    // main called with args, one per parameter it declares; runs don't
+    // share any state, each has a VM of its own
+    ast::Var run(std::vector<ast::Var> args = std::vector<ast::Var>()) const;
+    // the same, with a failure reported in the result instead of thrown
+    RunResult tryRun(std::vector<ast::Var> args = std::vector<ast::Var>()) const;
+
+    // main called once per input, the input being its only argument, on
+    // threads threads (one per core for 0). Results reach output on the
+    // calling thread in input order, each as soon as it and all before it
+    // are done; only a few inputs per thread are read ahead. A failed run
+    // is reported in its result, a failing input or output stops the
+    // batch after the runs started so far. Returns the number of inputs.
+    size_t runBatch(const BatchInput &next, const BatchOutput &output, unsigned threads = 0) const;
+
+    // main called with args as a Task, which runs about steps steps (loop
+    // iterations and calls) at a time, or up to blocking builtins only for
+    // 0; nothing runs before the first Task::resume(). The script has to
+    // outlive the task.
+    std::unique_ptr<Task> start(std::vector<ast::Var> args = std::vector<ast::Var>(),
+                                unsigned steps = ast::Budget::checkInterval) const;
+
+    const vm::Module& module() const { return compiled; }
+
+private:
+    friend class Task;
+    explicit Script(const Options &options_) : options(options_) {}
+
+    ast::Var run(std::vector<ast::Var> args, const ast::Budget &budget) const;
+    RunResult tryRun(std::vector<ast::Var> args, const ast::Budget &budget) const;
+
+    // parses, links and compiles readers, reporting errors under names
+    void build(std::vector<std::unique_ptr<Reader>> readers, const std::vector<std::string> &names);
+
+    Options options;
+    ast::Program program;
+    vm::Module compiled;
+};
+
+// A run of a script that gives its thread back every so many steps, and
+// before builtins blocking on files, so one thread, e.g. that of a host's
+// event loop, can take turns between many runs without a thread for each.
+// The run keeps going on a stack of its own, from where it stopped, at
+// every resume(); destroying an unfinished task abandons the run. Tasks
+// never run on their own, and resume() has to be called by one thread at
+// a time.
+class Task
+{
+public:
+    // scripts keep their calls on the heap, the stack only has to fit
+    // the VM and the builtins
+    static const size_t stackSize = 1 << 20;
+
+    ~Task();
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // runs the script until it yields or ends; false once it has ended
+    bool resume();
+
+    bool done() const { return finished; }
+    // what main returned, or why it failed, once done()
+    const RunResult& result() const { return outcome; }
+
+private:
+    friend class Script;
+    Task(const Script &script, std::vector<ast::Var> args, unsigned steps);
+
+    struct Coroutine;
+    std::unique_ptr<Coroutine> coroutine;
+    RunResult outcome;
+    bool finished = false;
+};
+
+// A program kept in memory while its source is being edited, for watch
+// and REPL use. Every update() gets the whole source, but only the
+// functions around what changed since the last one, and those calling
+// them, are scanned and parsed again; the rest of the program stays as it
+// was, and calls to replaced functions are bound to the new ones.
+// Functions after an edit keep the line numbers they were parsed with.
+class Session
+{
+public:
+    explicit Session(const Options &options_ = Options());
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // throws if the new source doesn't parse or link, keeping the last
+    // good one, which the next update is then compared with
+    void update(std::string source);
+
+    // functions parsed by the last successful update
+    const std::vector<std::string>& reparsed() const { return parsed; }
+
+    // main run by the tree-walker: nothing has to be compiled after an
+    // edit, and there's no native code that could call a replaced function
+    ast::Var run() const;
+
+private:
+    struct Function {
+        std::string id;
+        // offset of its fun keyword; it runs up to the next function
+        size_t begin;
+    };
+
+    Options options;
+    ast::Program program;
+    std::string text;
+    std::vector<Function> functions;
+    std::vector<std::string> parsed;
+};
+
+}
+
+#endif
@@ -5,13 +5,25 @@
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <sys/stat.h>
 #include "scanner/Token.hpp"
 #include "scanner/TokenType.hpp"
 #include "scanner/TokenTypeWrapper.hpp"
 #include "scanner/Scanner.hpp"
 #include "parser/Parser.hpp"
+#include "reader/Reader.hpp"
 #include "std/Std.hpp"
 #include "ast/Return.hpp"
+#include "vm/Compiler.hpp"
+#include "vm/VM.hpp"
+#include "vm/Cache.hpp"
+#include "engine/Engine.hpp"
 
 using namespace scanner;
 using namespace parser;
@@ -19,6 +31,41 @@ using namespace stdlibrary;
 
 typedef std::vector<Token> t_vec;
 
+// modification time of path in nanoseconds, 0 if it can't be read
+std::int64_t modified(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return 0;
+    return std::int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+// runs path every time it's saved, parsing only the functions that changed
+int watch(const std::string &path, const engine::Options &options) {
+    engine::Session session(options);
+    std::int64_t seen = -1;
+    while (true) {
+        std::int64_t time = modified(path);
+        if (time == seen) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        seen = time;
+
+        std::ifstream file(path, std::ios::binary);
+        std::stringstream source;
+        source << file.rdbuf();
+        try {
+            auto start = std::chrono::steady_clock::now();
+            session.update(source.str());
+            std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+            std::cerr << "parsed " << session.reparsed().size() << " function(s) in " << took.count() << " ms" << std::endl;
+            std::cout << session.run() << std::endl;
+        } catch (std::exception &e) {
+            std::cout << e.what() << std::endl;
+        }
+    }
+}
+
 void printTokens(t_vec const& tokens) {
     for (auto &i: tokens) {
         std::cout << i.toString() + ": " + i.valToString() << std::endl;
@@ -26,10 +73,64 @@ void printTokens(t_vec const& tokens) {
 }
 
 int main(int argc, char* argv[]) {
-    Parser parser;
-    Std stdlib(parser);
+    ast::Program program;
+    Std stdlib(program);
 
-    if(argc != 2) {
+    bool treeWalk = false;
+    bool useCache = false;
+    bool dumpTokens = false;
+    bool lazy = false;
+    bool optimize = true;
+    bool jit = false;
+    bool countStats = false;
+    std::uint64_t maxSteps = 0;
+    std::uint64_t timeout = 0;
+    std::string cacheDir;
+    std::string profilePath;
+    std::string batchPath;
+    bool batchBinary = false;
+    bool watching = false;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--tree") {
+            treeWalk = true;
+        } else if (arg == "--dump-tokens") {
+            dumpTokens = true;
+        } else if (arg == "--no-opt") {
+            optimize = false;
+        } else if (arg == "--jit") {
+            jit = true;
+        } else if (arg == "--stats") {
+            countStats = true;
+        } else if (arg == "--watch") {
+            watching = true;
+        } else if (arg == "--lazy") {
+            lazy = true;
+        } else if (arg == "--cache") {
+            useCache = true;
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            useCache = true;
+            cacheDir = argv[++i];
+        } else if ((arg == "--batch" || arg == "--batch-binary") && i + 1 < argc) {
+            batchBinary = arg == "--batch-binary";
+            batchPath = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profilePath = argv[++i];
+        } else if ((arg == "--max-steps" || arg == "--timeout") && i + 1 < argc) {
+            std::uint64_t &limit = arg == "--max-steps" ? maxSteps : timeout;
+            try {
+                limit = std::stoull(argv[++i]);
+            } catch (std::exception &) {
+                BOOST_LOG_TRIVIAL(error) << arg << " needs a number";
+                return -1;
+            }
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if(paths.empty()) {
         BOOST_LOG_TRIVIAL(error) << "Need to pass a path to code file!\n";
         return -1;
     }
@@ -37,22 +138,152 @@ int main(int argc, char* argv[]) {
     typedef TokenTypeWrapper TTW;
     TTW::getInstance();
     
-    std::ifstream f;
-    f.open(argv[1]);
-    if(!f.good()) {
-        BOOST_LOG_TRIVIAL(error) << "Error occured when tried to open given path";
-        return -2;
+    std::vector<std::unique_ptr<SourceFile>> sources;
+    for (auto &path : paths) {
+        sources.push_back(std::make_unique<SourceFile>(path));
+        if(!sources.back()->good()) {
+            BOOST_LOG_TRIVIAL(error) << "Error occured when tried to open given path";
+            return -2;
+        }
+    }
+
+    if (dumpTokens) {
+        for (auto &source : sources) {
+            Scanner scanner(source->reader());
+            scanner.retainTokens(true);
+            try {
+                while (scanner.scan().getType() != TokenType::T_EOF) {}
+            } catch (std::exception &e) {
+                std::cout << e.what() << std::endl;
+            }
+            printTokens(scanner.getTokens());
+        }
+        return 0;
+    }
+
+    if (watching) {
+        if (paths.size() != 1) {
+            BOOST_LOG_TRIVIAL(error) << "--watch takes a single file";
+            return -1;
+        }
+        engine::Options options;
+        options.optimize = optimize;
+        options.budget = ast::Budget(maxSteps, std::chrono::milliseconds(timeout));
+        return watch(paths.front(), options);
+    }
+
+    // main run once per input vector, compiled once for all of them; - is
+    // the standard input
+    if (!batchPath.empty()) {
+        engine::Options options;
+        options.optimize = optimize;
+        options.jit = jit;
+        options.budget = ast::Budget(maxSteps, std::chrono::milliseconds(timeout));
+        std::ifstream file;
+        if (batchPath != "-") {
+            file.open(batchPath, batchBinary ? std::ios::binary : std::ios::in);
+            if (!file) {
+                BOOST_LOG_TRIVIAL(error) << "Error occured when tried to open " << batchPath;
+                return -2;
+            }
+        }
+        std::istream &in = batchPath == "-" ? std::cin : file;
+        try {
+            auto script = engine::Script::fromFiles(paths, options);
+            script->runBatch(batchBinary ? engine::binaryInput(in) : engine::textInput(in),
+                             [](const engine::BatchResult &result) {
+                                 if (result.error.empty())
+                                     std::cout << result.value << '\n';
+                                 else
+                                     std::cout << "error: " << result.error << '\n';
+                             });
+        } catch (std::exception &e) {
+            std::cout.flush();
+            std::cout << e.what() << std::endl;
+            return -3;
+        }
+        std::cout.flush();
+        return 0;
+    }
+
+    // the tree-walker needs the AST, so only bytecode runs are cached;
+    // streams can't be hashed up front
+    std::uint64_t hash = vm::Cache::hash(nullptr, 0);
+    for (auto &source : sources) {
+        useCache = useCache && source->mapped();
+        hash = vm::Cache::hash(source->data(), source->size(), hash);
+    }
+    // statements are only seen by the tree-walker
+    treeWalk = treeWalk || !profilePath.empty();
+    useCache = useCache && !treeWalk;
+    vm::Cache cache(paths.front(), cacheDir, hash, optimize ? vm::Cache::optimized : 0);
+    vm::Module module;
+    ast::Budget budget(maxSteps, std::chrono::milliseconds(timeout));
+    vm::VM machine;
+    machine.enableJit(jit);
+    machine.setBudget(budget);
+    ast::Stats stats;
+    if (useCache && cache.load(program, module)) {
+        if (countStats)
+            stats.attach();
+        try {
+            std::cout << machine.run(module) << std::endl;
+        } catch (std::exception &e) {
+            std::cout << e.what() << std::endl;
+            return -3;
+        }
+        if (countStats)
+            stats.report(std::cerr);
+        return 0;
+    }
+
+    std::vector<std::unique_ptr<Reader>> readers;
+    for (auto &source : sources)
+        readers.push_back(source->reader());
+    std::vector<std::string> errors = engine::parseSources(std::move(readers), program, lazy, optimize);
+    bool parsed = true;
+    for (size_t i = 0; i < errors.size(); ++i) {
+        if (errors[i].empty())
+            continue;
+        parsed = false;
+        if (errors.size() > 1)
+            std::cout << paths[i] << ": ";
+        std::cout << errors[i] << std::endl;
     }
-    parser.setScr(std::make_unique<Scanner>(f));
     try {
-        parser.parse();
+        program.link();
     } catch (std::exception &e) {
         std::cout << e.what() << std::endl;
+        return -3;
     }
-    f.close();
 
-    ast::Return ret = parser.run();
-    std::cout << ret.variable << std::endl;
+    if (countStats)
+        stats.attach();
+    // runtime errors come with the line and function they happened in
+    try {
+        if (treeWalk) {
+            std::unique_ptr<ast::Profiler> profiler;
+            if (!profilePath.empty())
+                profiler = std::make_unique<ast::Profiler>();
+            ast::Return ret = program.run(jit, budget, profiler.get());
+            std::cout << ret.variable << std::endl;
+            if (profiler) {
+                profiler->report(std::cerr);
+                std::ofstream stacks(profilePath);
+                profiler->collapsed(stacks);
+            }
+        } else {
+            module = vm::Compiler().compile(program);
+            if (useCache && parsed)
+                cache.store(module);
+            std::cout << machine.run(module) << std::endl;
+        }
+    } catch (std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return -3;
+    }
+    if (countStats)
+        stats.report(std::cerr);
 
     return 0;
-}
\ No newline at end of file
+}
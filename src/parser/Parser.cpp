@@ -11,6 +11,8 @@ const bool NOTHROW = false;
 
 void Parser::setScr(std::unique_ptr<Scanner> scr_) {
     scr = std::move(scr_);
+    // token symbols are then the ids the program's tables are indexed by
+    scr->shareSymbols(program.getSymbols());
 }
 
 void Parser::clearScr() {
@@ -28,31 +30,77 @@ bool Parser::accept(const TokenType type, bool doThrow) {
 
 void Parser::parseProgram() {
     while (scr->getToken().getType() != TokenType::T_EOF) {
-        if (accept(TokenType::K_Fun, NOTHROW)) {
-            parseFunction();
-        }
+        const char *begin = scr->tokenBegin;
+        accept(TokenType::K_Fun, THROW);
+        parseFunction(begin);
     }
 }
 
-void Parser::parseFunction() {
+void Parser::parseFunction(const char *begin) {
     std::unique_ptr<FunctionDefinition> fun;
     accept(TokenType::I_Identifier, THROW);
     fun = std::make_unique<FunctionDefinition>(current.getString());
+    starts.push_back(FunctionStart{fun->getId(), begin});
     accept(TokenType::T_OpenParen, THROW);
     parseArgs(*fun);
 
     FunctionDefinition* func = fun.get();
     program.addFunction(std::move(fun));
     accept(TokenType::T_OpenBrace, THROW);
-    parseStmtBlock(func->getFunctionBlock());
+    if (lazy) {
+        skimBody(*func);
+    } else {
+        function = func;
+        parseStmtBlock(func->getFunctionBlock());
+        if (optimizeBodies)
+            Optimizer(program.getArena()).function(func->getFunctionBlock());
+    }
+}
+
+void Parser::skimBody(FunctionDefinition &fun) {
+    const char *begin = scr->tokenBegin;
+    int line = scr->tokenLine;
+    int pos = scr->tokenPos;
+    const char *end = nullptr;
+
+    for (unsigned depth = 1; depth > 0; move()) {
+        switch (scr->getToken().getType()) {
+            case TokenType::T_OpenBrace:
+                ++depth; break;
+            case TokenType::T_CloseBrace:
+                if (--depth == 0) end = scr->tokenBegin + 1;
+                break;
+            case TokenType::T_EOF:
+                throw std::runtime_error("Function body not closed: " + fun.getId());
+            default:
+                break;
+        }
+    }
+
+    // the body, closing brace included, is parsed by a parser of its own;
+    // calls in it are bound against the program the function ended up in
+    bool optimizeBody = optimizeBodies;
+    FunctionDefinition *definition = &fun;
+    fun.setLazyBody([begin, end, line, pos, optimizeBody, definition](Program &owner, BlockStatement &body) {
+        auto scanner = std::make_unique<Scanner>(std::make_unique<Reader>(begin, end - begin));
+        scanner->startAt(line, pos - 1);
+        Parser parser(std::move(scanner));
+        parser.function = definition;
+        definition->internParams(*parser.program.getSymbols());
+        parser.next = parser.scr->scan();
+        parser.parseStmtBlock(body);
+        if (optimizeBody)
+            Optimizer(parser.program.getArena()).function(body);
+        owner.adopt(std::move(parser.program));
+    });
 }
 
 void Parser::parseArgs(FunctionDefinition &fun) {
     if (accept(TokenType::I_Identifier, NOTHROW)) {
-        fun.addParam(current.getString());
+        fun.addParam(current.getString(), current.getSymbol());
         while (accept(TokenType::T_Comma, NOTHROW)) {
             accept(TokenType::I_Identifier, THROW);
-            fun.addParam(current.getString());
+            fun.addParam(current.getString(), current.getSymbol());
         }
     }
     accept(TokenType::T_CloseParen, THROW);
@@ -60,338 +108,362 @@ void Parser::parseArgs(FunctionDefinition &fun) {
 
 void Parser::parseStmtBlock(BlockStatement &newBlock) {
     block = &newBlock;
-    std::unique_ptr<BlockStatement> newNewBlock;
+    BlockStatement* newNewBlock;
     TokenType tokenType;
-
-    while (!accept(TokenType::T_CloseBrace, NOTHROW)) {
-        move();
-        tokenType = current.getType();
-        switch(tokenType) 
-        {
-            case TokenType::K_If:
-                block->addStatement(std::move(parseIfStatement())); break;
-            case TokenType::K_While:
-                block->addStatement(std::move(parseWhileStatement())); break;
-            case TokenType::I_Identifier:
-                block->addStatement(std::move(parseAssignOrFunCall())); break;
-            case TokenType::K_Var:
-                block->addStatement(std::move(parseInitStatement())); break;
-            case TokenType::K_Return:
-                block->addStatement(std::move(parseReturnStatement())); break;
-            case TokenType::K_Continue:
-                block->addStatement(std::move(std::make_unique<ReturnStatement>(Return::Continue))); 
-                accept(TokenType::T_Semicolon, THROW); break;
-            case TokenType::K_Break:
-                block->addStatement(std::move(std::make_unique<ReturnStatement>(Return::Break))); 
-                accept(TokenType::T_Semicolon, THROW); break;
-            case TokenType::K_Append:
-                block->addStatement(std::move(parseAppendStatement())); break;
-            case TokenType::T_OpenBrace:
-                newNewBlock = std::move(std::make_unique<BlockStatement>(block));
-                parseStmtBlock(*newNewBlock);
-                block->addStatement(std::move(newNewBlock));
-                break;
-            default:
-                throw std::runtime_error("Block parse invalid");
+    std::vector<stmtPtr> statements;
+
+    try {
+        while (!accept(TokenType::T_CloseBrace, NOTHROW)) {
+            // the scanner's token is the one about to become current
+            int line = scr->tokenLine;
+            move();
+            tokenType = current.getType();
+            switch(tokenType) 
+            {
+                case TokenType::K_If:
+                    statements.push_back(parseIfStatement()); break;
+                case TokenType::K_While:
+                    statements.push_back(parseWhileStatement()); break;
+                case TokenType::I_Identifier:
+                    statements.push_back(parseAssignOrFunCall()); break;
+                case TokenType::K_Var:
+                    statements.push_back(parseInitStatement()); break;
+                case TokenType::K_Return:
+                    statements.push_back(parseReturnStatement()); break;
+                case TokenType::K_Continue:
+                    statements.push_back(make<ReturnStatement>(Return::Continue)); 
+                    accept(TokenType::T_Semicolon, THROW); break;
+                case TokenType::K_Break:
+                    statements.push_back(make<ReturnStatement>(Return::Break)); 
+                    accept(TokenType::T_Semicolon, THROW); break;
+                case TokenType::K_Append:
+                    statements.push_back(parseAppendStatement()); break;
+                case TokenType::T_OpenBrace:
+                    newNewBlock = make<BlockStatement>(block);
+                    parseStmtBlock(*newNewBlock);
+                    statements.push_back(newNewBlock);
+                    break;
+                default:
+                    throw std::runtime_error("Block parse invalid");
+            }
+            statements.back()->setLine(line);
         }
+    } catch (...) {
+        // what was parsed before the error stays runnable
+        newBlock.setStatements(span(statements));
+        throw;
     }
+    newBlock.setStatements(span(statements));
 
     block = const_cast<BlockStatement *>(newBlock.getParent());
 }
 
-std::unique_ptr<Statement> Parser::parseInitStatement() {
+Statement* Parser::parseInitStatement() {
 
     accept(TokenType::I_Identifier, THROW);
 
-    std::string id = current.getString();
-
-    if (block->existVariable(id))
+    if (block->existVariable(current.getSymbol()))
         throw std::runtime_error("Variable already initialized");
 
-    block->addVariable(id, Var());
-    std::unique_ptr<Expression> expr = std::make_unique<BaseMathExpr>(new Var());
+    Slot slot = block->addVariable(current.getSymbol());
+    exprPtr expr = make<BaseMathExpr>(make<Var>());
 
     if (accept(TokenType::T_Equal, NOTHROW)) {
-        expr = std::move(parseOrExpr());
+        expr = parseOrExpr();
     }
 
     accept(TokenType::T_Semicolon, THROW);
 
-    return std::make_unique<AssignStatement>(block->findVariable(id), std::move(expr));
+    return make<AssignStatement>(slot, flat(expr));
 }
 
-std::unique_ptr<Statement> Parser::parseAssignOrFunCall() {
-    std::unique_ptr<Statement> statement;
+Statement* Parser::parseAssignOrFunCall() {
+    Statement* statement;
     Token tk = current;
 
     if (accept(TokenType::T_OpenParen, NOTHROW)) {
-        statement = std::move(parseFunCall(tk.getString()));
+        statement = parseFunCall(tk);
         accept(TokenType::T_Semicolon, THROW);
     } else {
         existVariable();
-        statement = std::move(parseAssignStatement(block->findVariable(current.getString())));
+        statement = parseAssignStatement(block->findVariable(current.getSymbol()));
     }
-    return std::move(statement);
+    return statement;
 }
 
-std::unique_ptr<Statement> Parser::parseAssignStatement(Var &variable) {
-
-    Token tmp;
-    bool bracket;
-    std::unique_ptr<Expression> indexExpr;
-    std::unique_ptr<AssignStatement> assignStatement;
-    std::unique_ptr<Expression> logicExpr;
+Statement* Parser::parseAssignStatement(Slot variable) {
+    exprPtr indexExpr = nullptr;
+    exprPtr logicExpr;
 
     if (accept(TokenType::T_OpenBracket, NOTHROW)) {
-        bracket = true;
-        indexExpr = std::make_unique<OrExpr>(parseOrExpr());
+        indexExpr = flat(orExpr(parseOrExpr()));
         accept(TokenType::T_CloseBracket, THROW);
     }
 
     accept(TokenType::T_Equal, THROW);
-    logicExpr = std::make_unique<OrExpr>(parseOrExpr());
+    logicExpr = flat(orExpr(parseOrExpr()));
     accept(TokenType::T_Semicolon, THROW);
 
-    if (bracket)
-        assignStatement = std::make_unique<AssignStatement>(variable,
-                std::move(indexExpr),
-                std::move(logicExpr));
-    else 
-        assignStatement = std::make_unique<AssignStatement>(variable, std::move(logicExpr));
-
-    return std::move(assignStatement);
+    return make<AssignStatement>(variable, logicExpr, indexExpr);
 }
 
-std::unique_ptr<Statement> Parser::parseFunCall(std::string name) {
-    if (!program.existFunction(name)) {
-        throw std::runtime_error(
-                "Function not found: " + name);
-    }
-
-    FunctionDefinition &functionDef = program.findFunction(name);
-    auto functionCall = std::make_unique<FunctionCall>(functionDef);
-
-    if (!accept(TokenType::T_CloseParen, NOTHROW)) {
-        functionCall->addExpression(parseOrExpr());
-        while (!accept(TokenType::T_CloseParen, NOTHROW)) {
-            accept(TokenType::T_Comma, THROW);
-            functionCall->addExpression(parseOrExpr());
+Statement* Parser::parseFunCall(const Token &name) {
+    FunctionCall* functionCall = make<FunctionCall>(name.getString());
+    if (program.existFunction(name.getSymbol()))
+        functionCall->bind(program.findFunction(name.getSymbol()));
+    else if (program.existBuiltin(name.getSymbol()))
+        functionCall->bind(program.findBuiltin(name.getSymbol()));
+    else
+        program.addUnresolved(*functionCall);
+    if (function != nullptr)
+        function->addCall(*functionCall);
+
+    std::vector<exprPtr> args;
+    try {
+        if (!accept(TokenType::T_CloseParen, NOTHROW)) {
+            args.push_back(flat(parseOrExpr()));
+            while (!accept(TokenType::T_CloseParen, NOTHROW)) {
+                accept(TokenType::T_Comma, THROW);
+                args.push_back(flat(parseOrExpr()));
+            }
         }
+    } catch (...) {
+        functionCall->setArguments(span(args));
+        throw;
     }
+    functionCall->setArguments(span(args));
 
-    if (functionDef.size() != functionCall->size()) {
+    if (functionCall->bound() && functionCall->arity() != functionCall->size()) {
         throw std::runtime_error(
             "Wrong number of parameters in functionCall");
     }
 
-    return std::move(functionCall);
+    return functionCall;
 }
 
 
-std::unique_ptr<Statement> Parser::parseReturnStatement() {
-    std::unique_ptr<ReturnStatement>returnStatement = 
-        std::make_unique<ReturnStatement>(std::move(parseOrExpr()));
+Statement* Parser::parseReturnStatement() {
+    Statement* returnStatement = make<ReturnStatement>(flat(parseOrExpr()));
     accept(TokenType::T_Semicolon, THROW);
-    return std::move(returnStatement);
+    return returnStatement;
 }
 
-std::unique_ptr<Statement> Parser::parseIfStatement() {
-    std::unique_ptr<Expression> expression;
-    std::unique_ptr<BlockStatement> ifBlock;
-    std::unique_ptr<BlockStatement> elseBlock;
+Statement* Parser::parseIfStatement() {
+    exprPtr expression;
+    BlockStatement* ifBlock;
+    BlockStatement* elseBlock = nullptr;
 
     accept(TokenType::T_OpenParen, THROW);
-    expression = std::move(parseOrExpr());
+    expression = flat(parseOrExpr());
     accept(TokenType::T_CloseParen, THROW);
 
     accept(TokenType::T_OpenBrace, THROW);
-    ifBlock = std::make_unique<BlockStatement>(block);
+    ifBlock = make<BlockStatement>(block);
     parseStmtBlock(*ifBlock);
 
     if (accept(TokenType::K_Else, NOTHROW)) {
         accept(TokenType::T_OpenBrace, THROW);
-        elseBlock = std::make_unique<BlockStatement>(block);
+        elseBlock = make<BlockStatement>(block);
         parseStmtBlock(*elseBlock);
     }
 
-    return std::make_unique<IfStatement>(std::move(expression),
-                std::move(ifBlock), std::move(elseBlock));
+    return make<IfStatement>(expression, ifBlock, elseBlock);
 }
 
-std::unique_ptr<Statement> Parser::parseWhileStatement() {
-    std::unique_ptr<WhileStatement> whileStatement;
-    std::unique_ptr<Expression> expression;
-    std::unique_ptr<BlockStatement> whileBlock;
+Statement* Parser::parseWhileStatement() {
+    exprPtr expression;
+    BlockStatement* whileBlock;
 
     accept(TokenType::T_OpenParen, THROW);
-    expression = std::move(parseOrExpr());
+    expression = flat(parseOrExpr());
     accept(TokenType::T_CloseParen, THROW);
 
     accept(TokenType::T_OpenBrace, THROW);
-    whileBlock = std::make_unique<BlockStatement>(block);
+    whileBlock = make<BlockStatement>(block);
     parseStmtBlock(*whileBlock);
 
-    whileStatement = std::make_unique<WhileStatement>(std::move(expression),
-                                                      std::move(whileBlock));
-
-    return std::move(whileStatement);
+    return make<WhileStatement>(expression, whileBlock);
 }
 
-std::unique_ptr<Statement> Parser::parseAppendStatement() {
+Statement* Parser::parseAppendStatement() {
     accept(TokenType::T_OpenParen, THROW);
     accept(TokenType::I_Identifier, THROW);
-    Var& from = block->findVariable(current.getString());
+    Slot from = block->findVariable(current.getSymbol());
 
     accept(TokenType::T_Comma, THROW);
     accept(TokenType::I_Identifier, THROW);
-    Var& to = block->findVariable(current.getString());
+    Slot to = block->findVariable(current.getSymbol());
 
     accept(TokenType::T_CloseParen, THROW);
     accept(TokenType::T_Semicolon, THROW);
 
-    return std::move(std::make_unique<AppendStatement>(from, to));
+    return make<AppendStatement>(from, to);
 }
 
-std::unique_ptr<Statement> Parser::parseLenStatement() {
+Statement* Parser::parseLenStatement() {
     accept(TokenType::T_OpenParen, THROW);
     accept(TokenType::I_Identifier, THROW);
-    Var& var = block->findVariable(current.getString());
+    Slot var = block->findVariable(current.getSymbol());
 
     accept(TokenType::T_CloseParen, THROW);
 
-    return std::move(std::make_unique<LenStatement>(var));
+    return make<LenStatement>(var);
+}
+
+exprPtr Parser::orExpr(exprPtr expr) {
+    return make<OrExpr>(span(std::vector<exprPtr>{expr}));
+}
+
+// statements and call arguments evaluate expressions through their flat form
+exprPtr Parser::flat(exprPtr expr) {
+    FlatCode code;
+    expr->flatten(code);
+    return make<FlatExpr>(expr, span(code.getOps()), code.maxDepth());
 }
 
-std::unique_ptr<Expression> Parser::parseOrExpr() {
-    std::unique_ptr<OrExpr> logicExpr = std::make_unique<OrExpr>(std::move(parseAndExpr()));
+exprPtr Parser::parseOrExpr() {
+    std::vector<exprPtr> exprs{parseAndExpr()};
 
     while (accept(TokenType::T_Bar2, NOTHROW)) {
-        logicExpr->addOr(std::move(parseAndExpr()));
+        exprs.push_back(parseAndExpr());
     }
 
-    return std::move(logicExpr);
+    return make<OrExpr>(span(exprs));
 }
 
-std::unique_ptr<Expression> Parser::parseAndExpr() {
-    std::unique_ptr<AndExpr> andExpr = std::make_unique<AndExpr>(std::move(parseRelExpr()));
+exprPtr Parser::parseAndExpr() {
+    std::vector<exprPtr> exprs{parseRelExpr()};
 
     while (accept(TokenType::T_Ampersand2, NOTHROW)) {
-        andExpr->addAnd(std::move(parseRelExpr()));
+        exprs.push_back(parseRelExpr());
     }
 
-    return std::move(andExpr);
+    return make<AndExpr>(span(exprs));
 }
 
-std::unique_ptr<Expression> Parser::parseRelExpr() {
-    std::unique_ptr<RelationExpr> relationalExpr = std::make_unique<RelationExpr>(std::move(parseBaseLogicExpr()));
+exprPtr Parser::parseRelExpr() {
+    std::vector<exprPtr> exprs{parseBaseLogicExpr()};
+    std::vector<TokenType> ops;
 
     TokenType tokenType = next.getType();
 
     switch (tokenType) {
         case TokenType::T_Equal2:
-            move(); relationalExpr->addEqual(std::move(parseBaseLogicExpr())); break;
         case TokenType::T_NotEqual:
-            move(); relationalExpr->addNotEqual(std::move(parseBaseLogicExpr())); break;
         case TokenType::T_LessThan: 
-            move(); relationalExpr->addLessThan(std::move(parseBaseLogicExpr())); break;
         case TokenType::T_LeEqThan:
-            move(); relationalExpr->addLessEqual(std::move(parseBaseLogicExpr())); break;
         case TokenType::T_GreaterThan:
-            move(); relationalExpr->addGreaterThan(std::move(parseBaseLogicExpr())); break;
         case TokenType::T_GrEqThan:
-            move(); relationalExpr->addGreaterEqual(std::move(parseBaseLogicExpr())); break;
+            move();
+            ops.push_back(tokenType);
+            exprs.push_back(parseBaseLogicExpr());
+            break;
         default:
-            return std::move(relationalExpr);
+            break;
     }
 
-    return std::move(relationalExpr);
+    return make<RelationExpr>(span(exprs), span(ops));
 }
 
-std::unique_ptr<Expression> Parser::parseBaseLogicExpr() {
+exprPtr Parser::parseBaseLogicExpr() {
     if (accept(TokenType::T_Exclamation)) {
-        return std::make_unique<BaseLogicExpr>(std::move(parseAddExpr()), true);
+        return make<BaseLogicExpr>(parseAddExpr(), true);
     } else {
-        return std::make_unique<BaseLogicExpr>(std::move(parseAddExpr()));
+        return make<BaseLogicExpr>(parseAddExpr());
     }
 }
 
-std::unique_ptr<Expression> Parser::parseAddExpr() {
-    std::unique_ptr<AddExpr> mathExpr = std::make_unique<AddExpr>(std::move(parseMultExpr()));
+exprPtr Parser::parseAddExpr() {
+    std::vector<exprPtr> exprs{parseMultExpr()};
+    std::vector<TokenType> ops;
     TokenType tokenType;
 
     while (true) {
         tokenType = next.getType();
 
-        if (tokenType == TokenType::T_Plus) { move(); mathExpr->addPlus(std::move(parseMultExpr())); }
-        else if (tokenType == TokenType::T_Minus) { move(); mathExpr->addMinus(std::move(parseMultExpr())); }
+        if (tokenType == TokenType::T_Plus || tokenType == TokenType::T_Minus) {
+            move();
+            ops.push_back(tokenType);
+            exprs.push_back(parseMultExpr());
+        }
         else break;
     }
 
-    return std::move(mathExpr);
+    return make<AddExpr>(span(exprs), span(ops));
 }
 
-std::unique_ptr<Expression> Parser::parseMultExpr() {
-    std::unique_ptr<MultiExpr> multiExpr = std::make_unique<MultiExpr>(std::move(parseBaseMathExpr()));
+exprPtr Parser::parseMultExpr() {
+    std::vector<exprPtr> exprs{parseBaseMathExpr()};
+    std::vector<TokenType> ops;
     TokenType tokenType;
 
     while (true) {
         tokenType = next.getType();
 
-        if (tokenType == TokenType::T_Asterisk) { move(); multiExpr->addMultiply(std::move(parseBaseMathExpr())); }
-        else if (tokenType == TokenType::T_Slash) { move(); multiExpr->addDivide(std::move(parseBaseMathExpr())); }
+        if (tokenType == TokenType::T_Asterisk || tokenType == TokenType::T_Slash) {
+            move();
+            ops.push_back(tokenType);
+            exprs.push_back(parseBaseMathExpr());
+        }
         else break;
     }
 
-    return std::move(multiExpr);
+    return make<MultiExpr>(span(exprs), span(ops));
 }
 
-std::unique_ptr<Expression> Parser::parseBaseMathExpr() {
-    std::unique_ptr<BaseMathExpr> baseMathExpr;
+exprPtr Parser::parseBaseMathExpr() {
+    BaseMathExpr* baseMathExpr;
     bool unary = accept(TokenType::T_Minus, NOTHROW);
 
     if (accept(TokenType::L_Numeric, NOTHROW)) {
-        baseMathExpr = std::make_unique<BaseMathExpr>(new Var(VarType::INT, {current.getInteger()}), unary);
+        baseMathExpr = make<BaseMathExpr>(make<Var>(VarType::INT, valueVec{current.getInteger()}), unary);
 
     } else if (accept(TokenType::T_OpenBracket)) {
-        baseMathExpr = std::make_unique<BaseMathExpr>(new Var(parseVectorLiteral()), unary);
+        baseMathExpr = make<BaseMathExpr>(make<Var>(parseVectorLiteral()), unary);
+
+    } else if (accept(TokenType::L_String, NOTHROW)) {
+        // the vector of its character codes, e.g. a file name for load()
+        std::string_view text = current.getView();
+        valueVec codes;
+        for (char ch : text.substr(1, text.size() - 2))
+            codes.push_back(static_cast<unsigned char>(ch));
+        baseMathExpr = make<BaseMathExpr>(make<Var>(VarType::LIST, codes), unary);
 
     } else if (accept(TokenType::T_OpenParen)) {
-        baseMathExpr = std::make_unique<BaseMathExpr>(std::move(parseOrExpr()), unary);
+        baseMathExpr = make<BaseMathExpr>(parseOrExpr(), unary);
         accept(TokenType::T_CloseParen, THROW);
 
     } else if (accept(TokenType::K_Len)) {
-        baseMathExpr = std::make_unique<BaseMathExpr>(std::move(parseLenStatement()), unary);
+        baseMathExpr = make<BaseMathExpr>(parseLenStatement(), unary);
 
     } else if (accept(TokenType::I_Identifier)) {
         Token tk = current;
 
         if (accept(TokenType::T_OpenParen)) {
-            baseMathExpr = std::make_unique<BaseMathExpr>(std::move(parseFunCall(tk.getString())), unary);
+            baseMathExpr = make<BaseMathExpr>(parseFunCall(tk), unary);
         } else {
             existVariable();
 
             if (accept(TokenType::T_OpenBracket, NOTHROW)) {
-                std::unique_ptr<Expression> indexExpr;
-                indexExpr = std::make_unique<OrExpr>(parseOrExpr());
+                exprPtr indexExpr = orExpr(parseOrExpr());
                 if (accept(TokenType::T_Colon, NOTHROW)) {
-                std::unique_ptr<Expression> indexExprSlice;
-                indexExprSlice = std::make_unique<OrExpr>(parseOrExpr());
-                    baseMathExpr = std::make_unique<BaseMathExpr>(
-                        block->findVariable(tk.getString()), 
-                        std::move(indexExpr), std::move(indexExprSlice), unary);
+                    exprPtr indexExprSlice = orExpr(parseOrExpr());
+                    baseMathExpr = make<BaseMathExpr>(
+                        block->findVariable(tk.getSymbol()), 
+                        indexExpr, indexExprSlice, unary);
                 } else {
-                    baseMathExpr = std::make_unique<BaseMathExpr>(block->findVariable(tk.getString()), std::move(indexExpr), unary);
+                    baseMathExpr = make<BaseMathExpr>(block->findVariable(tk.getSymbol()), indexExpr, unary);
                 }
                 accept(TokenType::T_CloseBracket, THROW);
             } else {
-                baseMathExpr = std::make_unique<BaseMathExpr>(block->findVariable(current.getString()), unary);
+                baseMathExpr = make<BaseMathExpr>(block->findVariable(current.getSymbol()), unary);
             }
         }
     } else {
         throw std::runtime_error("Unknown math expression");
     }
 
-    return std::move(baseMathExpr);
+    return baseMathExpr;
 }
 
 Var Parser::parseVectorLiteral() {
@@ -407,7 +479,7 @@ Var Parser::parseVectorLiteral() {
 }
 
 bool Parser::existVariable() {
-    if (!block->existVariable(current.getString())) {
+    if (!block->existVariable(current.getSymbol())) {
         throw std::runtime_error(
                 "Variable not found: " + current.getString());
     }
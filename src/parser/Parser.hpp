@@ -2,6 +2,8 @@
 #define PARSER_PARSER_HPP_
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "../scanner/Scanner.hpp"
 #include "../scanner/TokenType.hpp"
@@ -9,6 +11,7 @@
 #include "../ast/Var.hpp"
 #include "../ast/VarType.hpp"
 #include "../ast/Program.hpp"
+#include "../ast/Optimizer.hpp"
 #include "../ast/Return.hpp"
 #include "../ast/statement/ReturnStatement.hpp"
 #include "../ast/statement/AssignStatement.hpp"
@@ -23,6 +26,7 @@
 #include "../ast/expression/Expression.hpp"
 #include "../ast/expression/OrExpr.hpp"
 #include "../ast/expression/RelationalExpr.hpp"
+#include "../ast/expression/FlatExpr.hpp"
 
 using namespace ast;
 using namespace scanner;
@@ -34,14 +38,33 @@ class Parser
 public:
 
     Parser() = default;
-    explicit Parser(std::unique_ptr<Scanner> scr_) : scr(std::move(scr_)) {}
+    explicit Parser(std::unique_ptr<Scanner> scr_) { setScr(std::move(scr_)); }
 
     void setScr(std::unique_ptr<Scanner> scr_);
     void clearScr();
 
+    // function bodies are only skimmed and get parsed on first use; needs
+    // a memory backed scanner whose source outlives the program
+    void parseBodiesLazily(bool lazy_) { lazy = lazy_; }
+    // runs the Optimizer over every function body once it's parsed
+    void optimize(bool optimize_) { optimizeBodies = optimize_; }
+
+    // where each function parsed so far starts in the scanned text (at its
+    // fun keyword), in source order
+    struct FunctionStart {
+        std::string id;
+        const char *begin;
+    };
+    const std::vector<FunctionStart>& functionStarts() const { return starts; }
+
     void parse() {
-        scr->scan(); 
-        parseProgram();
+        try {
+            scr->scan();
+            parseProgram();
+        } catch (...) {
+            program.discardUnresolved();
+            throw;
+        }
     }
 
     void move() {
@@ -50,37 +73,57 @@ public:
     }
     
     Return run();
+    Program& getProgram() { return program; }
 
 private:
     std::unique_ptr<Scanner> scr;
     Program program;
     BlockStatement* block = nullptr;
+    // function whose body is being parsed
+    FunctionDefinition* function = nullptr;
+    std::vector<FunctionStart> starts;
     Token current;
     Token next;
+    bool lazy = false;
+    bool optimizeBodies = true;
 
     void parseProgram();
     bool accept(TokenType type, bool doThrow = false);
-    void parseFunction();
+    void parseFunction(const char *begin);
     void parseArgs(FunctionDefinition &fun);
+    void skimBody(FunctionDefinition &fun);
     void parseStmtBlock(BlockStatement &newBlock);
-    std::unique_ptr<Statement> parseInitStatement();
-    std::unique_ptr<Statement> parseAssignOrFunCall();
-    std::unique_ptr<Statement> parseAssignStatement(Var &variable);
-    std::unique_ptr<Statement> parseFunCall(std::string name);
-    std::unique_ptr<Statement> parseReturnStatement();
-    std::unique_ptr<Statement> parseIfStatement();
-    std::unique_ptr<Statement> parseWhileStatement();
-    std::unique_ptr<Statement> parseAppendStatement();
-    std::unique_ptr<Statement> parseLenStatement();
-    std::unique_ptr<Expression> parseOrExpr();
-    std::unique_ptr<Expression> parseAndExpr();
-    std::unique_ptr<Expression> parseRelExpr();
-    std::unique_ptr<Expression> parseBaseLogicExpr();
-    std::unique_ptr<Expression> parseAddExpr();
-    std::unique_ptr<Expression> parseMultExpr();
-    std::unique_ptr<Expression> parseBaseMathExpr();
+    Statement* parseInitStatement();
+    Statement* parseAssignOrFunCall();
+    Statement* parseAssignStatement(Slot variable);
+    Statement* parseFunCall(const Token &name);
+    Statement* parseReturnStatement();
+    Statement* parseIfStatement();
+    Statement* parseWhileStatement();
+    Statement* parseAppendStatement();
+    Statement* parseLenStatement();
+    exprPtr parseOrExpr();
+    exprPtr parseAndExpr();
+    exprPtr parseRelExpr();
+    exprPtr parseBaseLogicExpr();
+    exprPtr parseAddExpr();
+    exprPtr parseMultExpr();
+    exprPtr parseBaseMathExpr();
+    exprPtr orExpr(exprPtr expr);
+    exprPtr flat(exprPtr expr);
     Var parseVectorLiteral();
     bool existVariable();
+
+    // nodes and their children go to the program's arena
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        return program.getArena().make<T>(std::forward<Args>(args)...);
+    }
+
+    template <class T>
+    Span<T> span(const std::vector<T> &items) {
+        return program.getArena().copy(items);
+    }
 };
 
 }
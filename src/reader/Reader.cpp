@@ -1,19 +1,63 @@
 #include "Reader.hpp"
 
 #include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 Reader::Reader(std::istream &istream_)
-        : istream(istream_) {}
+        : istream(&istream_), block(new char[blockSize]) {}
 
-char Reader::get() {
-    istream.get(sign);
-    return sign;
+Reader::Reader(const char *data, std::size_t size)
+        : cur(data), end(data + size) {}
+
+bool Reader::refill() {
+    if (istream == nullptr || !*istream)
+        return false;
+    istream->read(block.get(), blockSize);
+    std::streamsize count = istream->gcount();
+    if (count <= 0)
+        return false;
+    cur = block.get();
+    end = cur + count;
+    return true;
+}
+
+MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        length = static_cast<std::size_t>(info.st_size);
+        if (length == 0) {
+            mapped = true;
+        } else {
+            void *mem = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mem != MAP_FAILED) {
+                madvise(mem, length, MADV_SEQUENTIAL);
+                begin = static_cast<const char*>(mem);
+                mapped = true;
+            }
+        }
+    }
+    close(fd);
 }
 
-char Reader::peek() {
-    return static_cast<char>(istream.peek());
+MappedFile::~MappedFile() {
+    if (begin != nullptr)
+        munmap(const_cast<char*>(begin), length);
 }
 
-bool Reader::eof() {
-    return istream.eof();
-}
\ No newline at end of file
+SourceFile::SourceFile(const std::string &path) : mappedFile(path) {
+    if (!mappedFile.good())
+        stream.open(path);
+}
+
+std::unique_ptr<Reader> SourceFile::reader() {
+    if (mappedFile.good())
+        return std::make_unique<Reader>(mappedFile.data(), mappedFile.size());
+    return std::make_unique<Reader>(stream);
+}
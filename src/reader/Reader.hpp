@@ -1,23 +1,112 @@
 #ifndef READER_HPP_
 #define READER_HPP_
 
+#include <cstddef>
+#include <fstream>
 #include <istream>
 #include <memory>
+#include <string>
 
+// Characters of the source for the Scanner. It always works on a buffer
+// through plain pointers: a memory view (for example a MappedFile) is one
+// buffer, while an istream - pipes, stringstreams - is read block by block.
+// eof() turns true once get() or peek() tried to go past the last character,
+// like it does for std::istream.
 class Reader {
 public:
+    static const std::size_t blockSize = 1 << 16;
+
     explicit Reader(std::istream &istream);
+    // doesn't copy, data has to outlive the reader
+    Reader(const char *data, std::size_t size);
 
     Reader(const Reader &) = delete;
     const Reader &operator=(const Reader &) = delete;
 
-    char get();
-    char peek();
-    bool eof();
+    char get() {
+        if (cur == end && !refill()) {
+            atEnd = true;
+            return sign;
+        }
+        sign = *cur++;
+        return sign;
+    }
+
+    char peek() {
+        if (cur == end && !refill()) {
+            atEnd = true;
+            return static_cast<char>(std::char_traits<char>::eof());
+        }
+        return *cur;
+    }
+
+    bool eof() { return atEnd; }
+
+    // the whole source is one buffer in memory, which stays valid
+    bool inMemory() const { return istream == nullptr; }
+
+    // buffered characters not consumed yet, [current(), limit())
+    const char* current() const { return cur; }
+    const char* limit() const { return end; }
+    // consumes count buffered characters, count <= limit() - current()
+    void advance(std::size_t count) {
+        if (count == 0) return;
+        cur += count;
+        sign = cur[-1];
+    }
 
 private:
-    std::istream &istream;
+    bool refill();
+
+    std::istream *istream = nullptr;
+    std::unique_ptr<char[]> block;
+    const char *cur = nullptr;
+    const char *end = nullptr;
+    bool atEnd = false;
     char sign = 0;
 };
 
-#endif
\ No newline at end of file
+// Read-only memory mapping of a whole file. good() is false when the file
+// can't be opened or isn't a regular file that can be mapped.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    const MappedFile &operator=(const MappedFile &) = delete;
+
+    bool good() const { return mapped; }
+    const char* data() const { return begin; }
+    std::size_t size() const { return length; }
+
+private:
+    const char *begin = nullptr;
+    std::size_t length = 0;
+    bool mapped = false;
+};
+
+// Script file on disk: mapped when it's a regular file, read as a stream
+// otherwise (pipes, devices).
+class SourceFile {
+public:
+    explicit SourceFile(const std::string &path);
+
+    SourceFile(const SourceFile &) = delete;
+    const SourceFile &operator=(const SourceFile &) = delete;
+
+    bool good() const { return mappedFile.good() || stream.good(); }
+    bool mapped() const { return mappedFile.good(); }
+    // the whole file, only when mapped()
+    const char* data() const { return mappedFile.data(); }
+    std::size_t size() const { return mappedFile.size(); }
+
+    // the stream backend can be read only once
+    std::unique_ptr<Reader> reader();
+
+private:
+    MappedFile mappedFile;
+    std::ifstream stream;
+};
+
+#endif
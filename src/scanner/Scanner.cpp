@@ -12,12 +12,30 @@ Scanner::Scanner(std::istream &istream)
     //TokenTypeWrapper::getInstance();
 }
 
+Scanner::Scanner(std::unique_ptr<Reader> reader) {
+    text = reader.release();
+    pos = 0;
+    line = 1;
+}
+
+void Scanner::moveWhile(CharClass cls) {
+    // peek() refills the buffer once the chunk is used up
+    while (hasClass(text->peek(), cls)) {
+        const char *first = text->current();
+        std::size_t count = classSpan(first, text->limit(), cls);
+        tokenValue.append(first, count);
+        pos += count;
+        ch = first[count - 1];
+        text->advance(count);
+    }
+}
+
 bool Scanner::scanNumber() {
     bool clearNumber = true;
-    while (isDigit(text->peek())) move();
+    moveWhile(C_Digit);
     if (text->peek() == '.') {
         move();
-        while (isDigit(text->peek())) move();
+        moveWhile(C_Digit);
     }
     if (!isClearNumber(text->peek())) {
         while (!isLineBreak(text->peek()) && !text->eof()) move();
@@ -46,7 +64,7 @@ bool Scanner::scanString() {
 
 bool Scanner::scanIdentifier() {
     bool clearIdentifier = true;
-    while (isIdentifierPart(text->peek())) move();
+    moveWhile(C_IdentifierPart);
     if (!isClearIdentifier(text->peek())) {
         while (!isLineBreak(text->peek()) && !text->eof()) move();
         clearIdentifier = false;
@@ -64,6 +82,11 @@ void Scanner::skipWhitespaces() {
             continue;
         }
         if (isWhitespace(ch)) {
+            // the rest of the run is dropped in one go, then the character
+            // after it is moved to like moveWhitespace() does
+            std::size_t count = classSpan(text->current(), text->limit(), C_Whitespace);
+            text->advance(count);
+            pos += count;
             moveWhitespace();
             continue;
         }
@@ -73,7 +96,7 @@ void Scanner::skipWhitespaces() {
 
 
 void Scanner::moveWhitespace() {
-    tokenValue = std::string();
+    tokenValue.clear();
     move();
 }
 
@@ -103,7 +126,7 @@ Token Scanner::checkTwoCharToken(const char& expected, TokenType twoCharType, To
 
 Token Scanner::scan() {
     Token tk;
-    tokenValue = std::string();
+    tokenValue.clear();
     move();
 
     callPos = pos;
@@ -115,6 +138,9 @@ Token Scanner::scan() {
         token = Token(TokenType::T_EOF);
         return token;
     }
+    tokenBegin = text->current() - 1;
+    tokenLine = line;
+    tokenPos = pos;
 
     switch (ch) {
         case '"':
@@ -122,7 +148,7 @@ Token Scanner::scan() {
                 tk = Token(TokenType::UNDEFINED);
                 break;
             }
-            tk = Token(tokenValue);
+            tk = Token(symbols->intern(tokenValue));
             break;
         case '&':
             tk = checkTwoCharToken('&', TokenType::T_Ampersand2, TokenType::UNDEFINED);
@@ -181,7 +207,7 @@ Token Scanner::scan() {
                     tk = Token(TokenType::UNDEFINED); 
                     break; 
                 }
-                tk = Token(getKeywordOrIdentifier(), tokenValue); 
+                tk = Token(getKeywordOrIdentifier(), symbols->intern(tokenValue));
                 break;             
             }
             tk = Token(TokenType::UNDEFINED);
@@ -190,7 +216,10 @@ Token Scanner::scan() {
                     throw std::runtime_error(
                     std::to_string(line) + ":" + std::to_string(pos)
                     + " - Unknown Token: '" + tokenValue + "'\n");
-    else { tokens.push_back(tk); token = tk; }
+    else {
+        if (keepTokens) tokens.push_back(tk);
+        token = tk;
+    }
     //std::cout << TokenTypeWrapper::typeToString(tk.getType()) << std::endl;
     return tk;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <string>
 #include <limits>
+#include <memory>
 #include <vector>
 #include <stdexcept>
 #include <boost/variant.hpp>
@@ -13,6 +14,7 @@
 #include "TokenType.hpp"
 #include "TokenCheck.hpp"
 #include "TokenTypeWrapper.hpp"
+#include "../util/Interner.hpp"
 #include "../reader/Reader.hpp"
 
 namespace scanner
@@ -20,6 +22,7 @@ namespace scanner
 class Scanner {
 public:
     Scanner(std::istream &istream);
+    explicit Scanner(std::unique_ptr<Reader> reader);
     ~Scanner() { delete text; }
     bool scanNumber();
     bool scanString();
@@ -31,22 +34,35 @@ public:
     Token scan();
     const Token getToken() const { return token; }
 
-    std::vector<Token> getTokens() {
-        if (!scanFail) return tokens;
-        else return std::vector<Token>();
-    }
+    // tokens are only kept when asked for, parsing needs just the last one
+    void retainTokens(bool retain) { keepTokens = retain; }
+    const std::vector<Token>& getTokens() const { return tokens; }
     
     TokenType getKeywordOrIdentifier();
+    // text of the token being scanned; cleared, not reallocated, between tokens
     std::string tokenValue;
 
-    bool fail;
-
-    bool scanFail;
     int pos;
     int line;
 
     int callPos;
     int callLine;
+
+    // where the last token starts; the pointer is into the Reader's buffer,
+    // so it's only meaningful for memory backed readers
+    const char *tokenBegin = nullptr;
+    int tokenLine = 1;
+    int tokenPos = 0;
+
+    // interns into a table shared with others, like the Program being
+    // parsed, so names get the same ids; call before scanning
+    void shareSymbols(std::shared_ptr<util::Interner> symbols_) { symbols = std::move(symbols_); }
+
+    // for scanning a fragment of a bigger source, keeps messages accurate
+    void startAt(int line_, int pos_) {
+        line = line_;
+        pos = pos_;
+    }
 private: 
     inline void move() {
         pos++;
@@ -54,11 +70,19 @@ private:
         tokenValue += text->get();
     }
 
+    // move() over every following character of class cls, a buffered
+    // chunk at a time
+    void moveWhile(CharClass cls);
+
     Reader* text;
 
     char ch;
 
+    // backing store of identifier and string tokens, they only hold views
+    std::shared_ptr<util::Interner> symbols = std::make_shared<util::Interner>();
+
     Token token;
+    bool keepTokens = false;
     std::vector<Token> tokens;
 };
 }
@@ -2,33 +2,30 @@
 
 using namespace scanner;
 
-Token::Token() : type(TokenType::T_EOF) { TokenTypeWrapper::getInstance(); }
+Token::Token() : type(TokenType::T_EOF) {}
 
 Token::Token(int value) : 
     type(TokenType::L_Numeric) {
     val = value;
     isFloat = false;
-    TokenTypeWrapper::getInstance();
 }
 
 Token::Token(float value) : 
     type(TokenType::L_Numeric) {
     val = value;
     isFloat = true;
-    TokenTypeWrapper::getInstance();
 }
 
-Token::Token(std::string string) : type(TokenType::L_String) {
-    val = string;
+Token::Token(util::Interner::Symbol string) : type(TokenType::L_String), symbol(string.id) {
+    val = string.text;
     isFloat = false;
-    TokenTypeWrapper::getInstance();
 }
 
-Token::Token(TokenType ttype) : type(ttype) { TokenTypeWrapper::getInstance(); }
+Token::Token(TokenType ttype) : type(ttype) {}
 
-Token::Token(TokenType ttype, std::string value) {
+Token::Token(TokenType ttype, util::Interner::Symbol value) : symbol(value.id) {
     type = ttype;
-    val = value;
+    val = value.text;
 }
 
 std::string Token::toString() const {
@@ -36,7 +33,7 @@ std::string Token::toString() const {
 }
 
 std::string Token::toString(TokenType type) {
-    return TTW.typeToString(type);
+    return std::string(TokenTypeWrapper::typeToString(type));
 }
 
 std::string Token::valToString() const {
@@ -47,7 +44,7 @@ std::string Token::valToString() const {
         return std::to_string(std::get<int>(val));
     case TokenType::L_String:
     case TokenType::I_Identifier:
-        return std::get<std::string>(val);
+        return std::string(std::get<std::string_view>(val));
     default:
         return std::string();
     }
@@ -2,11 +2,13 @@
 #define SCANNER_TOKEN_HPP_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 #include <iostream>
 #include "TokenType.hpp"
 #include "TokenTypeWrapper.hpp"
+#include "../util/Interner.hpp"
 
 namespace scanner
 {
@@ -17,14 +19,18 @@ public:
     Token();
     Token(int);
     Token(float);
-    Token(std::string);
+    // the interner has to outlive the token, it only holds a view
+    explicit Token(util::Interner::Symbol);
     Token(TokenType);
-    Token(TokenType, std::string);
+    Token(TokenType, util::Interner::Symbol);
 
     TokenType getType() const { return type; }
     int getInteger() const { return std::get<int>(val); }
     float getFloat() const { return std::get<float>(val); }
-    std::string getString() const { return std::get<std::string>(val); }
+    std::string getString() const { return std::string(std::get<std::string_view>(val)); }
+    std::string_view getView() const { return std::get<std::string_view>(val); }
+    // id of the text in the scanner's interner, for identifiers and strings
+    unsigned getSymbol() const { return symbol; }
     std::string toString() const;
 
     static std::string toString(TokenType);
@@ -35,11 +41,12 @@ private:
     static TokenTypeWrapper TTW;
 
     bool isFloat;
+    unsigned symbol = util::Interner::none;
 
     std::variant<
         int,
         float,
-        std::string
+        std::string_view
     > val;
 };
 
@@ -1,54 +1,63 @@
 #include "TokenCheck.hpp"
-#include <cctype>
 
-bool isDigit(const char& ch) {
-    return std::isdigit(ch);
-}
-
-bool isLineBreak(const char& ch) {
-    return (ch == '\n' ||
-            ch == '\r');
-}
-
-bool isWhitespace(const char& ch) {
-    return (ch == ' ' || 
-            ch == '\t' || 
-            ch == '\v');
-}
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-bool isIdentifierStart(const char& ch) {
-    return std::isalpha(ch);
+bool isFloat(const std::string& tokenV) {
+    return (tokenV.find('.') != std::string::npos);
 }
 
-bool isIdentifierPart(const char& ch) {
-    return isIdentifierStart(ch) ||
-           ch == '_';
+#if defined(__SSE2__)
+
+namespace
+{
+
+// bit i set when byte i of chunk belongs to the class
+inline unsigned classMask(__m128i chunk, CharClass cls) {
+    __m128i hit;
+    switch (cls) {
+        case C_Digit: {
+            __m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+            hit = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+            break;
+        }
+        case C_Whitespace:
+            hit = _mm_or_si128(_mm_or_si128(
+                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\v')));
+            break;
+        case C_IdentifierPart: {
+            // folding case maps both letter ranges onto a-z
+            __m128i letter = _mm_sub_epi8(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+            hit = _mm_or_si128(
+                    _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(25)), letter),
+                    _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+            break;
+        }
+        default:
+            return 0;
+    }
+    return static_cast<unsigned>(_mm_movemask_epi8(hit));
 }
 
-bool isClearNumber(const char& ch) {
-    return (isWhitespace(ch) ||
-            ch == ':'  ||
-            ch == '+'  ||
-            ch == ','  ||
-            ch == '-'  ||
-            ch == '/'  ||
-            ch == '*'  ||
-            ch == ';'  ||
-            ch == '('  ||
-            ch == ')'  ||
-            ch == '&'  ||
-            ch == '|'  ||
-            ch == '!'  ||
-            ch == ']'  ||
-            ch == '='  ||
-            (ch >= '<' && ch <= '>'));
 }
 
-bool isClearIdentifier(const char& ch) {
-    return (isClearNumber(ch) ||
-            ch == '[');
+#endif
+
+std::size_t classSpan(const char *first, const char *last, CharClass cls) {
+    const char *it = first;
+#if defined(__SSE2__)
+    while (last - it >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+        unsigned mask = classMask(chunk, cls);
+        if (mask != 0xFFFF)
+            return it - first + __builtin_ctz(~mask);
+        it += 16;
+    }
+#endif
+    while (it != last && hasClass(*it, cls))
+        ++it;
+    return it - first;
 }
-
-bool isFloat(const std::string& tokenV) {
-    return (tokenV.find('.') != std::string::npos);
-}
\ No newline at end of file
@@ -1,15 +1,58 @@
 #ifndef SCANNER_TOKENCHECK_H_
 #define SCANNER_TOKENCHECK_H_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
-bool isDigit(const char&);
-bool isLineBreak(const char&);
-bool isWhitespace(const char&);
-bool isIdentifierStart(const char&);
-bool isIdentifierPart(const char&);
-bool isClearIdentifier(const char&);
-bool isClearNumber(const char&);
+// character classes, several can be set for one character
+enum CharClass : std::uint8_t {
+    C_Digit           = 1 << 0,
+    C_LineBreak       = 1 << 1,
+    C_Whitespace      = 1 << 2,     // not counting line breaks
+    C_IdentifierStart = 1 << 3,
+    C_IdentifierPart  = 1 << 4,
+    C_ClearNumber     = 1 << 5,     // may follow a number
+    C_ClearIdentifier = 1 << 6,     // may follow an identifier
+};
+
+constexpr std::array<std::uint8_t, 256> makeCharClasses() {
+    std::array<std::uint8_t, 256> table{};
+    for (int ch = '0'; ch <= '9'; ++ch)
+        table[ch] |= C_Digit;
+    for (int ch = 'a'; ch <= 'z'; ++ch) {
+        table[ch] |= C_IdentifierStart | C_IdentifierPart;
+        table[ch - 'a' + 'A'] |= C_IdentifierStart | C_IdentifierPart;
+    }
+    table['_'] |= C_IdentifierPart;
+    table['\n'] |= C_LineBreak;
+    table['\r'] |= C_LineBreak;
+    for (unsigned char ch : {' ', '\t', '\v'})
+        table[ch] |= C_Whitespace | C_ClearNumber | C_ClearIdentifier;
+    for (unsigned char ch : {':', '+', ',', '-', '/', '*', ';', '(', ')', '&', '|', '!', ']', '=', '<', '>'})
+        table[ch] |= C_ClearNumber | C_ClearIdentifier;
+    table['['] |= C_ClearIdentifier;
+    return table;
+}
+
+constexpr std::array<std::uint8_t, 256> charClasses = makeCharClasses();
+
+inline bool hasClass(char ch, CharClass cls) {
+    return charClasses[static_cast<unsigned char>(ch)] & cls;
+}
+
+inline bool isDigit(char ch) { return hasClass(ch, C_Digit); }
+inline bool isLineBreak(char ch) { return hasClass(ch, C_LineBreak); }
+inline bool isWhitespace(char ch) { return hasClass(ch, C_Whitespace); }
+inline bool isIdentifierStart(char ch) { return hasClass(ch, C_IdentifierStart); }
+inline bool isIdentifierPart(char ch) { return hasClass(ch, C_IdentifierPart); }
+inline bool isClearIdentifier(char ch) { return hasClass(ch, C_ClearIdentifier); }
+inline bool isClearNumber(char ch) { return hasClass(ch, C_ClearNumber); }
 bool isFloat(const std::string&);
 
+// length of the run of characters of class cls at the start of [first, last);
+// only C_Digit, C_Whitespace and C_IdentifierPart are supported
+std::size_t classSpan(const char *first, const char *last, CharClass cls);
+
 #endif
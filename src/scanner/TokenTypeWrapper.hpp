@@ -1,48 +1,154 @@
 #ifndef SCANNER_TOKENTYPE_WRAPPER_H_
 #define SCANNER_TOKENTYPE_WRAPPER_H_
 
-#include <map>
+#include <cstddef>
 #include <string>
-#include <iterator>
+#include <string_view>
 #include "TokenType.hpp"
 
 namespace scanner 
 {
 
+// String <-> TokenType conversions, all resolved from constant tables; the
+// lookups don't allocate and can run at compile time.
 class TokenTypeWrapper
 {
 public:
     static TokenTypeWrapper& getInstance();
 
-    static std::string typeToString(TokenType);
-    static std::string typeToRepr(TokenType);
-    static TokenType reprToType(std::string);
+    static constexpr std::string_view typeToString(TokenType type) {
+        return index(type) < count ? names[index(type)] : "UNDEFINED";
+    }
+
+    static constexpr std::string_view typeToRepr(TokenType type) {
+        return index(type) < count && !reprs[index(type)].empty() ? reprs[index(type)] : "UNDEFINED";
+    }
+
+    // keywords and operators; everything else is UNDEFINED
+    static constexpr TokenType reprToType(std::string_view str) {
+        switch (str.size()) {
+            case 1:
+                switch (str[0]) {
+                    case '{': return TokenType::T_OpenBrace;
+                    case '}': return TokenType::T_CloseBrace;
+                    case '(': return TokenType::T_OpenParen;
+                    case ')': return TokenType::T_CloseParen;
+                    case '[': return TokenType::T_OpenBracket;
+                    case ']': return TokenType::T_CloseBracket;
+                    case ':': return TokenType::T_Colon;
+                    case ';': return TokenType::T_Semicolon;
+                    case '.': return TokenType::T_Dot;
+                    case ',': return TokenType::T_Comma;
+                    case '=': return TokenType::T_Equal;
+                    case '<': return TokenType::T_LessThan;
+                    case '>': return TokenType::T_GreaterThan;
+                    case '!': return TokenType::T_Exclamation;
+                    case '+': return TokenType::T_Plus;
+                    case '-': return TokenType::T_Minus;
+                    case '*': return TokenType::T_Asterisk;
+                    case '/': return TokenType::T_Slash;
+                    default: return TokenType::UNDEFINED;
+                }
+            case 2:
+                if (str[1] == '=') {
+                    switch (str[0]) {
+                        case '=': return TokenType::T_Equal2;
+                        case '!': return TokenType::T_NotEqual;
+                        case '<': return TokenType::T_LeEqThan;
+                        case '>': return TokenType::T_GrEqThan;
+                        default: return TokenType::UNDEFINED;
+                    }
+                }
+                return matches(str, TokenType::K_If) ? TokenType::K_If
+                    : matches(str, TokenType::T_Bar2) ? TokenType::T_Bar2
+                    : matches(str, TokenType::T_Ampersand2) ? TokenType::T_Ampersand2
+                    : TokenType::UNDEFINED;
+            case 3:
+                switch (str[0]) {
+                    case 'f': return keyword(str, TokenType::K_Fun);
+                    case 'v': return keyword(str, TokenType::K_Var);
+                    case 'l': return keyword(str, TokenType::K_Len);
+                    default: return TokenType::UNDEFINED;
+                }
+            case 4:
+                return keyword(str, TokenType::K_Else);
+            case 5:
+                switch (str[0]) {
+                    case 'b': return keyword(str, TokenType::K_Break);
+                    case 'w': return keyword(str, TokenType::K_While);
+                    default: return TokenType::UNDEFINED;
+                }
+            case 6:
+                switch (str[0]) {
+                    case 'r': return keyword(str, TokenType::K_Return);
+                    case 'a': return keyword(str, TokenType::K_Append);
+                    default: return TokenType::UNDEFINED;
+                }
+            case 8:
+                return keyword(str, TokenType::K_Continue);
+            default:
+                return TokenType::UNDEFINED;
+        }
+    }
 
 private:
     TokenTypeWrapper() {}
     TokenTypeWrapper(const TokenTypeWrapper&) = delete;
     TokenTypeWrapper& operator=(const TokenTypeWrapper&) = delete;
 
-    typedef std::map<TokenType, std::string> TSMap_;
-    typedef std::map<std::string, TokenType> STMap_;
+    static constexpr std::size_t count = static_cast<std::size_t>(TokenType::UNDEFINED) + 1;
 
-    static TSMap_ reverseMap(STMap_ stmap) {
-        TSMap_ result;
+    static constexpr std::size_t index(TokenType type) {
+        return static_cast<std::size_t>(type);
+    }
 
-        for (auto &i: stmap) {
-            result[i.second] = i.first;
-        }
+    static constexpr bool matches(std::string_view str, TokenType type) {
+        return str == reprs[index(type)];
+    }
+
+    static constexpr TokenType keyword(std::string_view str, TokenType type) {
+        return matches(str, type) ? type : TokenType::UNDEFINED;
+    }
 
-        return result;
+    // both indexed by TokenType, in declaration order
+    static constexpr std::string_view names[count] = {
+        "K_Fun", "K_Return", "K_Break", "K_Continue", "K_If", "K_Else", "K_While", "K_Var",
+        "K_Append", "K_Len",
+        "T_OpenBrace", "T_CloseBrace", "T_OpenParen", "T_CloseParen", "T_OpenBracket",
+        "T_CloseBracket", "T_Colon", "T_Semicolon", "T_Dot", "T_Comma", "T_Equal", "T_Equal2",
+        "T_NotEqual", "T_LessThan", "T_GreaterThan", "T_LeEqThan", "T_GrEqThan", "T_Exclamation",
+        "T_Plus", "T_Minus", "T_Asterisk", "T_Slash", "T_Bar2", "T_Ampersand2", "T_EOF",
+        "I_Identifier", "L_String", "L_Numeric", "UNDEFINED",
     };
 
-    // maps without Identifiers and Literals for string <-> token conversion
-    static STMap_ reprTokenMap;
-    static TSMap_ tokenStringMap;
-    static TSMap_ tokenReprMap;
-    static TokenTypeWrapper* instance_;
+    // empty for identifiers, literals and the like
+    static constexpr std::string_view reprs[count] = {
+        "fun", "return", "break", "continue", "if", "else", "while", "var",
+        "append", "len",
+        "{", "}", "(", ")", "[",
+        "]", ":", ";", ".", ",", "=", "==",
+        "!=", "<", ">", "<=", ">=", "!",
+        "+", "-", "*", "/", "||", "&&", "",
+        "", "", "", "",
+    };
+
+    static constexpr bool consistent() {
+        for (std::size_t i = 0; i < count; ++i) {
+            TokenType type = static_cast<TokenType>(i);
+            if (!reprs[i].empty() && reprToType(reprs[i]) != type)
+                return false;
+        }
+        return names[count - 1] == "UNDEFINED";
+    }
+
+    friend struct TokenTableCheck;
+};
+
+// the switch in reprToType has to agree with the tables
+struct TokenTableCheck {
+    static_assert(TokenTypeWrapper::consistent(), "reprToType out of sync with the token tables");
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
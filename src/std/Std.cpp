@@ -1,74 +1,255 @@
 #include "Std.hpp"
 
-#include <sstream>
-#include <string>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "VectorFile.hpp"
+#include "../util/StealingPool.hpp"
 
 using namespace stdlibrary;
+using namespace ast;
 
-Std::Std(parser::Parser &parser) : parser(parser) {
-    sort();
-    filter();
-}
-
-
-void Std::sort() {
-    std::string str = " ";
-    std::stringstream sstr(str);
-    parser.setScr(std::make_unique<scanner::Scanner>(sstr));
-    sstr << "fun sort(arr) {\n"
-                "var length = len(arr);\n"
-                "var i = 0;\n"
-                "var j = 0;\n"
-                "var k = 0;\n"
-                "var tmp = 0;\n"
-
-                "while ( i < length ) {\n"
-                "    while ( j < (length - i - 1)) {\n"
-                "        if ( arr[j] > arr[j+1] ) {\n"
-                "            tmp = arr[j];\n"
-                "            arr[j] = arr[j+1];\n"
-                "            arr[j+1] = tmp;\n"
-                "        }\n"
-                "        j = j + 1;\n"
-                "    }\n"
-                "    i = i + 1;\n"
-                "    j = 0;\n"
-                "}\n"
-                "return arr;\n"
-            "}\n";
-    parser.parse();
-    parser.clearScr();
-}
-
-void Std::filter() {
-    std::string str = " ";
-    std::stringstream sstr(str);
-    parser.setScr(std::make_unique<scanner::Scanner>(sstr));
-    sstr << "fun filter(arr, where, isgreater) {\n"
-                "var length = len(arr);\n"
-                "var i = 0;\n"
-                "var new = 0;\n"
-                "var newLength = 1;\n"
-                "var v = 0;\n"
-                "while ( i < length ) {\n"
-                "    if (isgreater == 0) {\n"
-                "        if (arr[i] <= 5) {\n"
-                "            v = arr[i];\n"
-                "            append(v, new);\n"
-                "            newLength = newLength + 1;\n"
-                "        }\n"
-                "    }\n"
-                "    else {\n"
-                "        if (arr[i] >= 5) {\n"
-                "            v = arr[i];\n"
-                "            append(v, new);\n"
-                "            newLength = newLength + 1;\n"
-                "        }\n"
-                "    }\n"
-                "    i = i + 1;\n"
-                "}\n"
-                "return new[1:newLength];\n"
-            "}\n";
-    parser.parse();
-    parser.clearScr();
+namespace
+{
+
+// below this many elements threads cost more than they save
+const unsigned parallelThreshold = 1 << 16;
+
+// body(begin, end) over [0, size), split over the shared pool's threads
+// once there are enough values
+template <typename Body>
+void split(unsigned size, Body body) {
+    if (size < parallelThreshold) {
+        body(size_t(0), size_t(size));
+        return;
+    }
+    util::StealingPool::shared().parallelFor(size, parallelThreshold / 4, body);
+}
+
+possibleValue scalar(const Var &var) {
+    if (var.value.size() != 1)
+        throw std::runtime_error("Expected a single value");
+    return var.value[0];
+}
+
+// x compared to k: below it for dir < 0, equal for 0, above for dir > 0
+struct Predicate {
+    possibleValue k;
+    possibleValue dir;
+
+    bool operator()(possibleValue x) const {
+        return dir < 0 ? x < k : dir > 0 ? x > k : x == k;
+    }
+};
+
+// values of arr for which keep is true, in order; pieces are filtered
+// side by side and joined after
+template <typename Keep>
+valueVec keepIf(const valueVec &arr, Keep keep) {
+    std::mutex mutex;
+    std::map<size_t, valueVec> pieces;
+    split(arr.size(), [&arr, &keep, &mutex, &pieces](size_t begin, size_t end) {
+        valueVec piece;
+        piece.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i)
+            if (keep(arr[i]))
+                piece.push_back(arr[i]);
+        std::lock_guard<std::mutex> lock(mutex);
+        pieces.emplace(begin, std::move(piece));
+    });
+
+    if (pieces.size() == 1)
+        return std::move(pieces.begin()->second);
+    valueVec result;
+    size_t size = 0;
+    for (auto &piece : pieces)
+        size += piece.second.size();
+    result.reserve(size);
+    for (auto &piece : pieces)
+        result.append(piece.second.begin(), piece.second.end());
+    return result;
+}
+
+// sorts equal runs side by side, then merges neighbours pairwise
+void sortValues(valueVec &values) {
+    unsigned size = values.size();
+    unsigned workers = std::min(util::StealingPool::shared().concurrency(), 8u);
+    if (size < parallelThreshold || workers < 2) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    std::vector<possibleValue*> bounds;
+    for (unsigned i = 0; i <= workers; ++i)
+        bounds.push_back(values.begin() + static_cast<size_t>(size) * i / workers);
+
+    util::StealingPool &pool = util::StealingPool::shared();
+    pool.parallelFor(workers, 1, [&bounds](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i)
+            std::sort(bounds[i], bounds[i + 1]);
+    });
+    for (unsigned step = 1; step < workers; step *= 2) {
+        unsigned merges = (workers - step + 2 * step - 1) / (2 * step);
+        pool.parallelFor(merges, 1, [&bounds, step, workers](size_t first, size_t last) {
+            for (size_t m = first; m < last; ++m) {
+                unsigned i = m * 2 * step;
+                unsigned end = std::min(i + 2 * step, workers);
+                std::inplace_merge(bounds[i], bounds[i + step], bounds[end]);
+            }
+        });
+    }
+}
+
+// sort(arr)
+Var sort(Var *args) {
+    Var &arr = args[0];
+    sortValues(arr.value);
+    return Var(arr.type, std::move(arr.value));
+}
+
+// filter(arr, where, isgreater) - keeps values >= 5 when isgreater is
+// anything but 0, values <= 5 otherwise; where is unused, the threshold
+// has always been fixed
+Var filter(Var *args) {
+    bool greater = !(args[2].value == valueVec({0}));
+    return Var(VarType::INT, keepIf(args[0].value, [greater](possibleValue value) {
+        return greater ? value >= 5 : value <= 5;
+    }));
+}
+
+// keep(arr, k, dir) - the values below k when dir < 0, equal to it when
+// dir is 0 and above it when dir > 0
+Var keep(Var *args) {
+    return Var(VarType::INT, keepIf(args[0].value, Predicate{scalar(args[1]), scalar(args[2])}));
+}
+
+// count(arr, k, dir) - how many values keep() would keep
+Var count(Var *args) {
+    const valueVec &arr = args[0].value;
+    Predicate predicate{scalar(args[1]), scalar(args[2])};
+    std::atomic<unsigned> total{0};
+    split(arr.size(), [&arr, predicate, &total](size_t begin, size_t end) {
+        unsigned found = 0;
+        for (size_t i = begin; i < end; ++i)
+            found += predicate(arr[i]);
+        total.fetch_add(found, std::memory_order_relaxed);
+    });
+    return Var(VarType::INT, valueVec({static_cast<possibleValue>(total.load())}));
+}
+
+// map(arr, a, b) - every value x becomes a * x + b, wrapping around like
+// the arithmetic operators
+Var map(Var *args) {
+    const valueVec &arr = args[0].value;
+    unsigned a = scalar(args[1]);
+    unsigned b = scalar(args[2]);
+    valueVec result;
+    result.resizeUninitialized(arr.size());
+    possibleValue *out = result.data();
+    split(arr.size(), [&arr, out, a, b](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            out[i] = static_cast<possibleValue>(a * static_cast<unsigned>(arr[i]) + b);
+    });
+    return Var(VarType::INT, std::move(result));
+}
+
+// sum(arr) - wraps around like +; 0 for an empty arr
+Var sum(Var *args) {
+    const valueVec &arr = args[0].value;
+    std::atomic<unsigned> total{0};
+    split(arr.size(), [&arr, &total](size_t begin, size_t end) {
+        unsigned partial = 0;
+        for (size_t i = begin; i < end; ++i)
+            partial += static_cast<unsigned>(arr[i]);
+        total.fetch_add(partial, std::memory_order_relaxed);
+    });
+    return Var(VarType::INT, valueVec({static_cast<possibleValue>(total.load())}));
+}
+
+// smallest value for less, largest for greater; () for an empty arr
+template <typename Compare>
+Var extreme(const valueVec &arr, Compare compare) {
+    if (arr.empty())
+        return Var();
+    std::mutex mutex;
+    possibleValue best = arr[0];
+    split(arr.size(), [&arr, &compare, &mutex, &best](size_t begin, size_t end) {
+        possibleValue found = *std::min_element(arr.begin() + begin, arr.begin() + end, compare);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (compare(found, best))
+            best = found;
+    });
+    return Var(VarType::INT, valueVec({best}));
+}
+
+// min(arr), max(arr)
+Var min(Var *args) {
+    return extreme(args[0].value, std::less<possibleValue>());
+}
+
+Var max(Var *args) {
+    return extreme(args[0].value, std::greater<possibleValue>());
+}
+
+// reserve(arr, n) - arr with room for n values, so appending up to that
+// many doesn't reallocate; n of () or below arr's length changes nothing
+Var reserve(Var *args) {
+    Var &arr = args[0];
+    const valueVec &count = args[1].value;
+    if (count.size() > 1)
+        throw std::runtime_error("Cannot reserve a vector of values");
+    if (!count.empty() && count[0] > 0)
+        arr.value.reserve(static_cast<unsigned>(count[0]));
+    return Var(arr.type, std::move(arr.value));
+}
+
+// the character codes of a string literal
+std::string path(const Var &var) {
+    std::string text;
+    for (auto code : var.value) {
+        if (code <= 0 || code > 255)
+            throw std::runtime_error("Expected a file name");
+        text += static_cast<char>(code);
+    }
+    if (text.empty())
+        throw std::runtime_error("Expected a file name");
+    return text;
+}
+
+// load(path) - the vector stored in a vector file, see VectorFile.hpp
+Var load(Var *args) {
+    return Var(VarType::LIST, loadVector(path(args[0])));
+}
+
+// save(arr, path) - stores arr in a vector file, returns its length
+Var save(Var *args) {
+    storeVector(args[0].value, path(args[1]));
+    return Var(VarType::INT, valueVec{static_cast<possibleValue>(args[0].value.size())});
+}
+
+constexpr Builtin library[] = {
+    {"sort", 1, sort, true},
+    {"filter", 3, filter, true},
+    {"reserve", 2, reserve, true},
+    {"keep", 3, keep, true},
+    {"count", 3, count, true},
+    {"map", 3, map, true},
+    {"sum", 1, sum, true},
+    {"min", 1, min, true},
+    {"max", 1, max, true},
+    {"load", 1, load, false, true},
+    {"save", 2, save, false, true},
+};
+
+}
+
+Std::Std(parser::Parser &parser) : Std(parser.getProgram()) {}
+
+Std::Std(ast::Program &program) {
+    for (auto &builtin : library)
+        program.addBuiltin(builtin);
 }
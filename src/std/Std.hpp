@@ -4,17 +4,16 @@
 #include "../parser/Parser.hpp"
 
 namespace stdlibrary {
+    // registers the standard functions in the parser's program, so calls to
+    // them bind like calls to script functions. The library is a constant
+    // table of native builtins: nothing is scanned or parsed at startup.
     class Std {
     public:
         explicit Std(parser::Parser& parser);
-
-    private:
-        parser::Parser& parser;
-        void sort();
-        void filter();
+        explicit Std(ast::Program& program);
     };
 
 }
 
 
-#endif 
\ No newline at end of file
+#endif
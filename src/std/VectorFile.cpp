@@ -0,0 +1,115 @@
+#include "VectorFile.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../util/TempName.hpp"
+
+using namespace stdlibrary;
+using namespace ast;
+
+namespace
+{
+
+const char magic[4] = {'S', 'C', 'R', 'V'};
+const std::uint32_t version = 1;
+const size_t headerSize = 32;
+// zero bytes at the end of the header
+const size_t reserved = 16;
+
+static_assert(reserved >= ValueVec::mappedHeader, "a mapped vector keeps its header in the reserved bytes");
+static_assert(sizeof(possibleValue) == 4, "vector files hold int32 values");
+
+bool littleEndian() {
+    const std::uint32_t probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 1;
+}
+
+std::uint64_t readLittle(const unsigned char *bytes, unsigned count) {
+    std::uint64_t val = 0;
+    for (unsigned i = 0; i < count; ++i)
+        val |= std::uint64_t(bytes[i]) << (8 * i);
+    return val;
+}
+
+void writeLittle(unsigned char *bytes, std::uint64_t val, unsigned count) {
+    for (unsigned i = 0; i < count; ++i)
+        bytes[i] = static_cast<unsigned char>((val >> (8 * i)) & 0xFF);
+}
+
+// closes the descriptor on the way out
+struct File {
+    int fd;
+    ~File() { if (fd >= 0) close(fd); }
+};
+
+}
+
+ValueVec stdlibrary::loadVector(const std::string &path) {
+    File file{open(path.c_str(), O_RDONLY)};
+    struct stat info;
+    if (file.fd < 0 || fstat(file.fd, &info) != 0 || !S_ISREG(info.st_mode))
+        throw std::runtime_error("Cannot open vector file " + path);
+
+    unsigned char header[headerSize];
+    if (info.st_size < off_t(headerSize) || pread(file.fd, header, headerSize, 0) != ssize_t(headerSize)
+        || std::memcmp(header, magic, sizeof(magic)) != 0 || readLittle(header + 4, 4) != version)
+        throw std::runtime_error("Not a vector file: " + path);
+    std::uint64_t count = readLittle(header + 8, 8);
+    if (count > std::numeric_limits<unsigned>::max()
+        || std::uint64_t(info.st_size) != headerSize + count * sizeof(possibleValue))
+        throw std::runtime_error("Corrupted vector file: " + path);
+    if (count == 0)
+        return ValueVec();
+
+    size_t length = headerSize + count * sizeof(possibleValue);
+    if (!littleEndian()) {
+        ValueVec values;
+        values.resizeUninitialized(count);
+        std::vector<unsigned char> bytes(count * sizeof(possibleValue));
+        if (pread(file.fd, bytes.data(), bytes.size(), headerSize) != ssize_t(bytes.size()))
+            throw std::runtime_error("Cannot read vector file " + path);
+        for (unsigned i = 0; i < count; ++i)
+            values[i] = static_cast<possibleValue>(readLittle(&bytes[i * sizeof(possibleValue)], 4));
+        return values;
+    }
+
+    // private, so writes through the vector never reach the file
+    void *mem = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file.fd, 0);
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("Cannot map vector file " + path);
+    return ValueVec::mapped(mem, headerSize, static_cast<unsigned>(count));
+}
+
+void stdlibrary::storeVector(const ValueVec &values, const std::string &path) {
+    unsigned char header[headerSize] = {};
+    std::memcpy(header, magic, sizeof(magic));
+    writeLittle(header + 4, version, 4);
+    writeLittle(header + 8, values.size(), 8);
+
+    std::string temporary = util::tempName(path);
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), headerSize);
+    if (littleEndian()) {
+        out.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size()) * sizeof(possibleValue));
+    } else {
+        for (auto value : values) {
+            unsigned char bytes[sizeof(possibleValue)];
+            writeLittle(bytes, static_cast<std::uint32_t>(value), sizeof(bytes));
+            out.write(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+        }
+    }
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot write vector file " + path);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef STD_VECTORFILE_HPP_
+#define STD_VECTORFILE_HPP_
+
+#include <string>
+#include "../ast/ValueVec.hpp"
+
+// Vectors stored as raw little-endian int32 values after a 32 byte header:
+// "SCRV", a uint32 version (1), a uint64 element count and 16 zero bytes.
+// Loading maps the file and hands the mapping to the vector, so nothing is
+// read up front or copied; storing writes straight from the vector.
+namespace stdlibrary
+{
+
+// throws if the file can't be mapped or isn't a vector file
+ast::ValueVec loadVector(const std::string &path);
+// replaces path, through a temporary file next to it, so a vector mapped
+// from the old file stays valid
+void storeVector(const ast::ValueVec &values, const std::string &path);
+
+}
+
+#endif
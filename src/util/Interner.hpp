@@ -0,0 +1,62 @@
+#ifndef UTIL_INTERNER_HPP_
+#define UTIL_INTERNER_HPP_
+
+#include <climits>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace util
+{
+
+// Keeps a single copy of every distinct identifier and string literal, and
+// numbers them in the order they're first seen, so tables keyed by a name
+// can be flat vectors indexed by its id. Views it hands out stay valid for
+// as long as the interner lives, and looking up a text seen before doesn't
+// allocate. Not synchronized; a program and the scanners feeding it share
+// one from a single thread.
+class Interner
+{
+public:
+    static const unsigned none = UINT_MAX;
+
+    struct Symbol {
+        std::string_view text;
+        unsigned id;
+    };
+
+    Interner() = default;
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    Symbol intern(std::string_view text) {
+        auto it = ids.find(text);
+        if (it != ids.end())
+            return Symbol{it->first, it->second};
+
+        // deque never moves its elements, so views into them remain valid
+        storage.emplace_back(text);
+        Symbol symbol{storage.back(), static_cast<unsigned>(storage.size() - 1)};
+        ids.emplace(symbol.text, symbol.id);
+        return symbol;
+    }
+
+    // id of a text interned before, none if it never was
+    unsigned find(std::string_view text) const {
+        auto it = ids.find(text);
+        return it != ids.end() ? it->second : none;
+    }
+
+    const std::string& text(unsigned id) const { return storage[id]; }
+
+    size_t size() const { return storage.size(); }
+
+private:
+    std::deque<std::string> storage;
+    std::unordered_map<std::string_view, unsigned> ids;
+};
+
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef UTIL_STEALINGPOOL_HPP_
+#define UTIL_STEALINGPOOL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+
+// Worker threads with a deque of tasks each. A worker takes its newest
+// task first and, once out of them, steals the oldest of another worker,
+// so the big early pieces of a split end up spread over the threads.
+//
+// parallelFor() is the only way in: the calling thread runs tasks too
+// while it waits, so a loop started from inside another one (or from one
+// of the workers) can't deadlock the pool.
+class StealingPool
+{
+public:
+    // one worker less than there are cores, the caller makes up for it
+    static StealingPool& shared() {
+        static StealingPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    explicit StealingPool(unsigned threads) : queues(std::max(1u, threads)) {
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([this, i] { work(i); });
+    }
+
+    ~StealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleeping);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    StealingPool(const StealingPool&) = delete;
+    StealingPool& operator=(const StealingPool&) = delete;
+
+    // threads that can run a loop at once, the caller included
+    unsigned concurrency() const { return workers.size() + 1; }
+
+    // body(begin, end) over [0, size) in pieces of at least grain; returns
+    // once every piece is done and rethrows what the first failing piece
+    // threw. Without workers, or with too little to split, it's one call.
+    template <typename Body>
+    void parallelFor(size_t size, size_t grain, Body body) {
+        size_t pieces = std::min<size_t>(concurrency() * 4, (size + grain - 1) / std::max<size_t>(grain, 1));
+        if (workers.empty() || pieces < 2) {
+            if (size > 0)
+                body(size_t(0), size);
+            return;
+        }
+
+        auto group = std::make_shared<Group>();
+        group->remaining = pieces;
+        for (size_t i = 0; i < pieces; ++i) {
+            size_t begin = size * i / pieces;
+            size_t end = size * (i + 1) / pieces;
+            push(i, [group, body, begin, end] {
+                if (!group->failed.load(std::memory_order_relaxed)) {
+                    try {
+                        body(begin, end);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(group->mutex);
+                        if (!group->failed.exchange(true))
+                            group->error = std::current_exception();
+                    }
+                }
+                group->remaining.fetch_sub(1, std::memory_order_acq_rel);
+            });
+        }
+
+        while (group->remaining.load(std::memory_order_acquire) > 0) {
+            if (!runOne(0))
+                std::this_thread::yield();
+        }
+        if (group->error)
+            std::rethrow_exception(group->error);
+    }
+
+private:
+    typedef std::function<void()> Task;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct Group {
+        std::atomic<size_t> remaining{0};
+        std::atomic<bool> failed{false};
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    void push(size_t hint, Task task) {
+        Queue &queue = queues[hint % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        pending.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(sleeping);
+        }
+        wakeup.notify_one();
+    }
+
+    // newest task of queue own, else the oldest one of any other queue
+    bool runOne(size_t own) {
+        Task task;
+        for (size_t i = 0; i < queues.size() && !task; ++i) {
+            Queue &queue = queues[(own + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+        if (!task)
+            return false;
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        return true;
+    }
+
+    void work(unsigned own) {
+        while (true) {
+            if (runOne(own))
+                continue;
+            std::unique_lock<std::mutex> lock(sleeping);
+            wakeup.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+            if (stopping)
+                return;
+        }
+    }
+
+    std::vector<Queue> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> pending{0};
+    std::mutex sleeping;
+    std::condition_variable wakeup;
+    bool stopping = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef UTIL_TEMPNAME_HPP_
+#define UTIL_TEMPNAME_HPP_
+
+#include <atomic>
+#include <string>
+#include <unistd.h>
+
+namespace util
+{
+
+// Name next to path for a file written aside and then renamed over it.
+// No other writer gets the same one, in this process or another, so
+// writers of the same path at once never share their temporary file.
+inline std::string tempName(const std::string &path) {
+    static std::atomic<unsigned> serial{0};
+    return path + "." + std::to_string(getpid()) + "." + std::to_string(serial.fetch_add(1)) + ".tmp";
+}
+
+}
+
+#endif
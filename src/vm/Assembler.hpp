@@ -0,0 +1,140 @@
+#ifndef VM_ASSEMBLER_HPP_
+#define VM_ASSEMBLER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace vm
+{
+
+enum class Reg : std::uint8_t {
+    rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi,
+    r8, r9, r10, r11, r12, r13, r14, r15
+};
+
+// condition part of jcc/setcc
+enum class Cond : std::uint8_t {
+    B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, A = 0x7, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF
+};
+
+// Encoder for the few x86-64 instructions the Jit needs. Memory operands
+// are always [rbx + disp32], which is where the Jit keeps its registers.
+class Assembler
+{
+public:
+    // mov r32, [rbx + disp] / mov r64, [rbx + disp]
+    void load32(Reg dst, int disp) { memory(false, 0x8B, dst, disp); }
+    void load64(Reg dst, int disp) { memory(true, 0x8B, dst, disp); }
+    void store32(int disp, Reg src) { memory(false, 0x89, src, disp); }
+    void store64(int disp, Reg src) { memory(true, 0x89, src, disp); }
+    // mov dword/qword [rbx + disp], imm32
+    void storeImm32(int disp, std::int32_t imm) { memory(false, 0xC7, Reg::rax, disp); imm32(imm); }
+    void storeImm64(int disp, std::int32_t imm) { memory(true, 0xC7, Reg::rax, disp); imm32(imm); }
+
+    // op r32, [rbx + disp]
+    void add32(Reg dst, int disp) { memory(false, 0x03, dst, disp); }
+    void sub32(Reg dst, int disp) { memory(false, 0x2B, dst, disp); }
+    void and32(Reg dst, int disp) { memory(false, 0x23, dst, disp); }
+    void or32(Reg dst, int disp) { memory(false, 0x0B, dst, disp); }
+    void cmp32(Reg lhs, int disp) { memory(false, 0x3B, lhs, disp); }
+    void cmp64(Reg lhs, int disp) { memory(true, 0x3B, lhs, disp); }
+    // no REX prefix, so only for rax..rdi
+    void imul32(Reg dst, int disp) { byte(0x0F); memory(false, 0xAF, dst, disp); }
+    // cmp dword [rbx + disp], imm32 / inc dword [rbx + disp]
+    void cmpImm(int disp, std::int32_t imm) { memory(false, 0x81, Reg::rdi, disp); imm32(imm); }
+    void inc32(int disp) { memory(false, 0xFF, Reg::rax, disp); }
+    // lea r64, [rbx + disp]
+    void lea64(Reg dst, int disp) { memory(true, 0x8D, dst, disp); }
+
+    // op dst, src on registers
+    void mov32(Reg dst, Reg src) { direct(false, 0x89, src, dst); }
+    void mov64(Reg dst, Reg src) { direct(true, 0x89, src, dst); }
+    void and32(Reg dst, Reg src) { direct(false, 0x21, src, dst); }
+    void or32(Reg dst, Reg src) { direct(false, 0x09, src, dst); }
+    void xor32(Reg dst, Reg src) { direct(false, 0x31, src, dst); }
+    void cmp32(Reg lhs, Reg rhs) { direct(false, 0x39, rhs, lhs); }
+    void cmp64(Reg lhs, Reg rhs) { direct(true, 0x39, rhs, lhs); }
+    void test32(Reg lhs, Reg rhs) { direct(false, 0x85, rhs, lhs); }
+    void xorImm(Reg dst, std::int8_t imm) { direct(false, 0x83, Reg::rsi, dst); byte(imm); }
+    void cmpImm(Reg lhs, std::int8_t imm) { direct(false, 0x83, Reg::rdi, lhs); byte(imm); }
+    void add64(Reg dst, std::int32_t imm) { direct(true, 0x81, Reg::rax, dst); imm32(imm); }
+    void sub64(Reg dst, std::int32_t imm) { direct(true, 0x81, Reg::rbp, dst); imm32(imm); }
+    void inc64(Reg dst) { direct(true, 0xFF, Reg::rax, dst); }
+    void dec64(Reg dst) { direct(true, 0xFF, Reg::rcx, dst); }
+    void neg32(Reg dst) { direct(false, 0xF7, Reg::rbx, dst); }
+    void idiv32(Reg src) { direct(false, 0xF7, Reg::rdi, src); }
+    void cdq() { byte(0x99); }
+    void mov32(Reg dst, std::uint32_t imm) { rex(false, Reg::rax, dst); byte(0xB8 + low(dst)); imm32(imm); }
+    void mov64(Reg dst, std::uint64_t imm) {
+        rex(true, Reg::rax, dst);
+        byte(0xB8 + low(dst));
+        for (int i = 0; i < 8; ++i)
+            byte(static_cast<std::uint8_t>(imm >> (8 * i)));
+    }
+
+    // setcc on the low byte of rax, then movzx eax, al
+    void setcc(Cond cond) {
+        byte(0x0F); byte(0x90 + static_cast<std::uint8_t>(cond)); byte(0xC0);
+        byte(0x0F); byte(0xB6); byte(0xC0);
+    }
+
+    // mov [r64], r64
+    void storeAt(Reg base, Reg src) { rex(true, src, base); byte(0x89); byte((low(src) << 3) | low(base)); }
+
+    void push(Reg reg) { rex(false, Reg::rax, reg); byte(0x50 + low(reg)); }
+    void pop(Reg reg) { rex(false, Reg::rax, reg); byte(0x58 + low(reg)); }
+    void call(Reg target) { direct(false, 0xFF, Reg::rdx, target); }
+    void ret() { byte(0xC3); }
+
+    // rel32 jumps and calls; they return the position passed to patch()
+    size_t jmp() { byte(0xE9); return rel32(); }
+    size_t jcc(Cond cond) { byte(0x0F); byte(0x80 + static_cast<std::uint8_t>(cond)); return rel32(); }
+    size_t call() { byte(0xE8); return rel32(); }
+    void patch(size_t at, size_t target) {
+        std::int32_t rel = static_cast<std::int32_t>(target) - static_cast<std::int32_t>(at + 4);
+        std::memcpy(code.data() + at, &rel, sizeof(rel));
+    }
+
+    size_t position() const { return code.size(); }
+    const std::vector<std::uint8_t>& bytes() const { return code; }
+
+private:
+    static std::uint8_t low(Reg reg) { return static_cast<std::uint8_t>(reg) & 7; }
+    static bool high(Reg reg) { return static_cast<std::uint8_t>(reg) >= 8; }
+
+    void byte(std::uint8_t value) { code.push_back(value); }
+    void imm32(std::uint32_t value) {
+        for (int i = 0; i < 4; ++i)
+            byte(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+    size_t rel32() { imm32(0); return code.size() - 4; }
+
+    void rex(bool wide, Reg reg, Reg rm) {
+        std::uint8_t prefix = 0x40 | (wide ? 8 : 0) | (high(reg) ? 4 : 0) | (high(rm) ? 1 : 0);
+        if (prefix != 0x40)
+            byte(prefix);
+    }
+
+    // opcode with a ModRM of reg and [rbx + disp32]
+    void memory(bool wide, std::uint8_t opcode, Reg reg, int disp) {
+        rex(wide, reg, Reg::rbx);
+        byte(opcode);
+        byte(0x80 | (low(reg) << 3) | low(Reg::rbx));
+        imm32(static_cast<std::uint32_t>(disp));
+    }
+
+    // opcode with a register-direct ModRM
+    void direct(bool wide, std::uint8_t opcode, Reg reg, Reg rm) {
+        rex(wide, reg, rm);
+        byte(opcode);
+        byte(0xC0 | (low(reg) << 3) | low(rm));
+    }
+
+    std::vector<std::uint8_t> code;
+};
+
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include "Bounds.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+
+using namespace vm;
+
+namespace
+{
+
+const std::int64_t unknown = INT64_MIN;
+const int none = -1;
+
+// what holds before an instruction
+struct State {
+    // a scalar >= 0
+    std::vector<bool> nonNegative;
+    std::vector<std::int64_t> constant;
+    // register whose len() this one holds
+    std::vector<int> lengthOf;
+    // (i, n) when this one holds i < n
+    std::vector<std::pair<int, int>> test;
+    // (i, v) with 0 <= i < len(v), sorted
+    std::vector<std::pair<int, int>> inRange;
+    bool reached = false;
+
+    void reset(unsigned registers) {
+        reached = true;
+        nonNegative.assign(registers, false);
+        constant.assign(registers, unknown);
+        lengthOf.assign(registers, none);
+        test.assign(registers, {none, none});
+        inRange.clear();
+    }
+
+    bool has(int i, int v) const {
+        return std::binary_search(inRange.begin(), inRange.end(), std::make_pair(i, v));
+    }
+
+    bool indexes(int i) const {
+        for (auto &pair : inRange)
+            if (pair.first == i)
+                return true;
+        return false;
+    }
+
+    void add(int i, int v) {
+        auto pair = std::make_pair(i, v);
+        auto it = std::lower_bound(inRange.begin(), inRange.end(), pair);
+        if (it == inRange.end() || *it != pair)
+            inRange.insert(it, pair);
+    }
+
+    // reg got a new value; sizeKept when only its elements changed
+    void kill(int reg, bool sizeKept = false) {
+        nonNegative[reg] = false;
+        constant[reg] = unknown;
+        lengthOf[reg] = none;
+        test[reg] = {none, none};
+        for (unsigned r = 0; r < test.size(); ++r) {
+            if (test[r].first == reg || test[r].second == reg)
+                test[r] = {none, none};
+            if (!sizeKept && lengthOf[r] == reg)
+                lengthOf[r] = none;
+        }
+        inRange.erase(std::remove_if(inRange.begin(), inRange.end(), [reg, sizeKept](const std::pair<int, int> &pair) {
+            return pair.first == reg || (!sizeKept && pair.second == reg);
+        }), inRange.end());
+    }
+
+    // keeps what from holds as well; true on a change
+    bool meet(const State &from) {
+        bool changed = false;
+        for (unsigned r = 0; r < constant.size(); ++r) {
+            if (nonNegative[r] && !from.nonNegative[r]) {
+                nonNegative[r] = false;
+                changed = true;
+            }
+            if (constant[r] != unknown && constant[r] != from.constant[r]) {
+                constant[r] = unknown;
+                changed = true;
+            }
+            if (lengthOf[r] != none && lengthOf[r] != from.lengthOf[r]) {
+                lengthOf[r] = none;
+                changed = true;
+            }
+            if (test[r].first != none && test[r] != from.test[r]) {
+                test[r] = {none, none};
+                changed = true;
+            }
+        }
+        std::vector<std::pair<int, int>> both;
+        std::set_intersection(inRange.begin(), inRange.end(), from.inRange.begin(), from.inRange.end(),
+                              std::back_inserter(both));
+        if (both.size() != inRange.size()) {
+            inRange = std::move(both);
+            changed = true;
+        }
+        return changed;
+    }
+
+    // what follows from reg being true: i < len(v) for an i < n test
+    void assume(int reg) {
+        int i = test[reg].first, n = test[reg].second;
+        if (i != none && lengthOf[n] != none && nonNegative[i])
+            add(i, lengthOf[n]);
+    }
+};
+
+void transfer(const Chunk &chunk, const Instruction &in, State &state) {
+    int a = in.a, b = in.b, c = in.c;
+    switch (in.op) {
+        case OpCode::LoadConst: {
+            const ast::Var &value = chunk.constants[b];
+            state.kill(a);
+            if (value.value.size() == 1) {
+                state.constant[a] = value.value[0];
+                state.nonNegative[a] = value.value[0] >= 0;
+            }
+            break;
+        }
+        case OpCode::Move: {
+            if (a == b)
+                break;
+            State before = state;
+            state.kill(a);
+            state.nonNegative[a] = before.nonNegative[b];
+            state.constant[a] = before.constant[b];
+            state.lengthOf[a] = before.lengthOf[b];
+            state.test[a] = before.test[b];
+            for (auto &pair : before.inRange) {
+                if (pair.first == b)
+                    state.add(a, pair.second);
+                if (pair.second == b)
+                    state.add(pair.first, a);
+            }
+            break;
+        }
+        case OpCode::Len:
+            state.kill(a);
+            if (a != b)
+                state.lengthOf[a] = b;
+            break;
+        case OpCode::LtInt:
+        case OpCode::GtInt: {
+            state.kill(a);
+            int i = in.op == OpCode::LtInt ? b : c;
+            int n = in.op == OpCode::LtInt ? c : b;
+            if (a != i && a != n)
+                state.test[a] = {i, n};
+            break;
+        }
+        case OpCode::AddInt: {
+            // i + 1 can't overflow when i < len(v)
+            auto step = [&state](int i, int k) {
+                return state.nonNegative[i] && state.indexes(i)
+                       && (state.constant[k] == 0 || state.constant[k] == 1);
+            };
+            bool nonNegative = step(b, c) || step(c, b);
+            state.kill(a);
+            state.nonNegative[a] = nonNegative;
+            break;
+        }
+        case OpCode::StoreIndex:
+        case OpCode::StoreIndexInBounds:
+            state.kill(a, true);
+            break;
+        case OpCode::Call:
+        case OpCode::CallNative:
+            for (unsigned reg = c; reg < chunk.registers; ++reg)
+                state.kill(reg);
+            state.kill(a);
+            break;
+        case OpCode::Jump:
+        case OpCode::JumpIfFalse:
+        case OpCode::JumpIfTrue:
+        case OpCode::Step:
+        case OpCode::Return:
+        case OpCode::ReturnNone:
+            break;
+        default:
+            state.kill(a);
+            break;
+    }
+}
+
+}
+
+void Bounds::specialize(Chunk &chunk) {
+    size_t n = chunk.code.size();
+    if (n == 0)
+        return;
+
+    std::vector<State> before(n);
+    std::vector<bool> queued(n, false);
+    std::vector<size_t> work;
+    before[0].reset(chunk.registers);
+    work.push_back(0);
+    queued[0] = true;
+
+    auto flow = [&](size_t target, const State &state) {
+        if (target >= n)
+            return;
+        bool changed = !before[target].reached;
+        if (changed)
+            before[target] = state;
+        else
+            changed = before[target].meet(state);
+        if (changed && !queued[target]) {
+            queued[target] = true;
+            work.push_back(target);
+        }
+    };
+
+    while (!work.empty()) {
+        size_t pc = work.back();
+        work.pop_back();
+        queued[pc] = false;
+
+        const Instruction &in = chunk.code[pc];
+        State state = before[pc];
+        transfer(chunk, in, state);
+        if (in.op == OpCode::Jump) {
+            flow(in.b, state);
+        } else if (in.op == OpCode::JumpIfFalse || in.op == OpCode::JumpIfTrue) {
+            State taken = state;
+            taken.assume(in.a);
+            flow(in.b, in.op == OpCode::JumpIfTrue ? taken : state);
+            flow(pc + 1, in.op == OpCode::JumpIfFalse ? taken : state);
+        } else if (in.op != OpCode::Return && in.op != OpCode::ReturnNone) {
+            flow(pc + 1, state);
+        }
+    }
+
+    for (size_t pc = 0; pc < n; ++pc) {
+        Instruction &in = chunk.code[pc];
+        if (!before[pc].reached)
+            continue;
+        if (in.op == OpCode::Index && before[pc].has(in.c, in.b))
+            in.op = OpCode::IndexInBounds;
+        else if (in.op == OpCode::StoreIndex && before[pc].has(in.b, in.a))
+            in.op = OpCode::StoreIndexInBounds;
+    }
+}
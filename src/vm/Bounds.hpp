@@ -0,0 +1,25 @@
+#ifndef VM_BOUNDS_HPP_
+#define VM_BOUNDS_HPP_
+
+#include "Bytecode.hpp"
+
+namespace vm
+{
+
+// Finds indexing whose index is provably in range: v[i] behind a test
+// i < len(v), with i never negative (a constant >= 0, or one more than
+// an index already in range) and neither i nor the size of v changed
+// since. A forward pass over the chunk like Types, keeping for every
+// register whether it's >= 0, its constant, the vector it holds len() of
+// and the i < n it holds the result of, plus the pairs known in range.
+class Bounds
+{
+public:
+    // turns Index and StoreIndex with such an index into their InBounds
+    // forms, which skip the range check; run after Types
+    static void specialize(Chunk &chunk);
+};
+
+}
+
+#endif
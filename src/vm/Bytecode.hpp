@@ -0,0 +1,92 @@
+#ifndef VM_BYTECODE_HPP_
+#define VM_BYTECODE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../ast/Var.hpp"
+#include "../ast/Builtin.hpp"
+
+namespace vm
+{
+
+// a, b, c - register operands unless stated otherwise
+enum class OpCode : std::uint8_t {
+    LoadConst,      // a = constants[b]
+    Move,           // a = b
+    Neg,            // a = -b
+    Not,            // a = !b
+    Add,            // a = b + c
+    Sub,            // a = b - c
+    Mul,            // a = b * c
+    Div,            // a = b / c
+    Eq,             // a = b == c
+    Ne,             // a = b != c
+    Lt,             // a = b < c
+    Gt,             // a = b > c
+    Le,             // a = b <= c
+    Ge,             // a = b >= c
+    And,            // a = b && c
+    Or,             // a = b || c
+    // the same, with b and c known to hold a single int each, see Types
+    AddInt,
+    SubInt,
+    MulInt,
+    DivInt,
+    EqInt,
+    NeInt,
+    LtInt,
+    GtInt,
+    LeInt,
+    GeInt,
+    Index,          // a = b[c]
+    Slice,          // a = b[c:c+1]
+    StoreIndex,     // a[b] = c
+    // the same, with the index known to be in range, see Bounds
+    IndexInBounds,
+    StoreIndexInBounds,
+    Len,            // a = len(b)
+    Append,         // append(b, a)
+    Jump,           // pc = b
+    JumpIfFalse,    // if (!a) pc = b
+    JumpIfTrue,     // if (a) pc = b
+    Step,           // a budget step, where an inlined call was
+    Call,           // a = chunks[b](c, c+1, ...)
+    CallNative,     // a = natives[b](c, c+1, ...)
+    Return,         // return a
+    ReturnNone,     // return ()
+};
+
+struct Instruction {
+    OpCode op;
+    std::uint16_t a;
+    std::uint16_t b;
+    std::uint16_t c;
+};
+
+// where an instruction comes from: its statement's source line and the
+// chunk of the function it was written in, which inlined code keeps
+struct Position {
+    std::uint32_t line;
+    std::uint32_t chunk;
+};
+
+struct Chunk {
+    std::string name;
+    unsigned params = 0;
+    unsigned registers = 0;
+    std::vector<Instruction> code;
+    // one per instruction
+    std::vector<Position> positions;
+    std::vector<ast::Var> constants;
+};
+
+struct Module {
+    std::vector<Chunk> chunks;
+    std::vector<const ast::Builtin*> natives;
+    unsigned entry = 0;
+};
+
+}
+
+#endif
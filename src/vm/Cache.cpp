@@ -0,0 +1,349 @@
+#include "Cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "Bounds.hpp"
+#include "Types.hpp"
+#include "../ast/Program.hpp"
+#include "../util/TempName.hpp"
+
+using namespace vm;
+using namespace ast;
+
+namespace
+{
+
+const char magic[4] = {'S', 'C', 'R', 'C'};
+
+class Writer
+{
+public:
+    explicit Writer(std::ostream &os_) : os(os_) {}
+
+    void u8(std::uint8_t val) { os.put(static_cast<char>(val)); }
+    void u16(std::uint16_t val) { bytes(val, 2); }
+    void u32(std::uint32_t val) { bytes(val, 4); }
+    void u64(std::uint64_t val) { bytes(val, 8); }
+
+    void str(const std::string &val) {
+        u32(val.size());
+        os.write(val.data(), val.size());
+    }
+
+    void var(const Var &val) {
+        u8(static_cast<std::uint8_t>(val.type));
+        u32(val.value.size());
+        for (auto element : val.value)
+            u32(static_cast<std::uint32_t>(element));
+    }
+
+private:
+    // little endian regardless of the host
+    void bytes(std::uint64_t val, unsigned count) {
+        for (unsigned i = 0; i < count; ++i)
+            os.put(static_cast<char>((val >> (8 * i)) & 0xFF));
+    }
+
+    std::ostream &os;
+};
+
+class Reader
+{
+public:
+    explicit Reader(std::istream &is_) : is(is_) {}
+
+    std::uint8_t u8() { return bytes(1); }
+    std::uint16_t u16() { return bytes(2); }
+    std::uint32_t u32() { return bytes(4); }
+    std::uint64_t u64() { return bytes(8); }
+
+    std::string str() {
+        std::string val(count(), '\0');
+        is.read(&val[0], val.size());
+        check();
+        return val;
+    }
+
+    Var var() {
+        VarType type = static_cast<VarType>(u8());
+        if (type > VarType::UNDEFINED)
+            throw std::runtime_error("Corrupted cache entry");
+        valueVec value;
+        value.resizeUninitialized(count());
+        for (auto &element : value)
+            element = static_cast<possibleValue>(u32());
+        return Var(type, std::move(value));
+    }
+
+    // element count, bounded so a corrupted entry can't ask for gigabytes
+    std::uint32_t count() {
+        std::uint32_t val = u32();
+        if (val > (1u << 24))
+            throw std::runtime_error("Corrupted cache entry");
+        return val;
+    }
+
+private:
+    std::uint64_t bytes(unsigned count) {
+        std::uint64_t val = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            int byte = is.get();
+            check();
+            val |= static_cast<std::uint64_t>(byte & 0xFF) << (8 * i);
+        }
+        return val;
+    }
+
+    void check() {
+        if (!is)
+            throw std::runtime_error("Truncated cache entry");
+    }
+
+    std::istream &is;
+};
+
+// every operand in range for what its opcode does with it, so the VM,
+// which trusts the compiler and checks none of them, stays in bounds
+bool valid(const Chunk &chunk, const Module &module) {
+    auto reg = [&](unsigned r) { return r < chunk.registers; };
+    auto target = [&](unsigned pc) { return pc < chunk.code.size(); };
+
+    // operands are 16 bit, so a frame never needs more registers
+    if (chunk.registers > (1u << 16) || chunk.params > chunk.registers || chunk.code.empty())
+        return false;
+    for (auto &in : chunk.code) {
+        switch (in.op) {
+            case OpCode::LoadConst:
+                if (!reg(in.a) || in.b >= chunk.constants.size())
+                    return false;
+                break;
+            case OpCode::Move:
+            case OpCode::Neg:
+            case OpCode::Not:
+            case OpCode::Len:
+            case OpCode::Append:
+                if (!reg(in.a) || !reg(in.b))
+                    return false;
+                break;
+            case OpCode::Slice:
+                if (!reg(in.a) || !reg(in.b) || !reg(in.c + 1u))
+                    return false;
+                break;
+            case OpCode::Jump:
+                if (!target(in.b))
+                    return false;
+                break;
+            case OpCode::JumpIfFalse:
+            case OpCode::JumpIfTrue:
+                if (!reg(in.a) || !target(in.b))
+                    return false;
+                break;
+            case OpCode::Call:
+                if (!reg(in.a) || in.b >= module.chunks.size()
+                    || in.c + module.chunks[in.b].params > chunk.registers)
+                    return false;
+                break;
+            case OpCode::CallNative:
+                if (!reg(in.a) || in.b >= module.natives.size()
+                    || in.c + module.natives[in.b]->arity > chunk.registers)
+                    return false;
+                break;
+            case OpCode::Return:
+                if (!reg(in.a))
+                    return false;
+                break;
+            case OpCode::Step:
+            case OpCode::ReturnNone:
+                break;
+            default:
+                // the three register forms, arithmetic to StoreIndexInBounds
+                if (!reg(in.a) || !reg(in.b) || !reg(in.c))
+                    return false;
+                break;
+        }
+    }
+    // running off the end is never valid either
+    OpCode last = chunk.code.back().op;
+    return last == OpCode::Jump || last == OpCode::Return || last == OpCode::ReturnNone;
+}
+
+// the checked form of op, or op itself
+OpCode generic(OpCode op) {
+    switch (op) {
+        case OpCode::AddInt: return OpCode::Add;
+        case OpCode::SubInt: return OpCode::Sub;
+        case OpCode::MulInt: return OpCode::Mul;
+        case OpCode::DivInt: return OpCode::Div;
+        case OpCode::EqInt: return OpCode::Eq;
+        case OpCode::NeInt: return OpCode::Ne;
+        case OpCode::LtInt: return OpCode::Lt;
+        case OpCode::GtInt: return OpCode::Gt;
+        case OpCode::LeInt: return OpCode::Le;
+        case OpCode::GeInt: return OpCode::Ge;
+        case OpCode::IndexInBounds: return OpCode::Index;
+        case OpCode::StoreIndexInBounds: return OpCode::StoreIndex;
+        default: return op;
+    }
+}
+
+}
+
+Cache::Cache(const std::string &scriptPath, const std::string &cacheDir, std::uint64_t sourceHash_,
+             std::uint32_t options_)
+    : sourceHash(sourceHash_), options(options_) {
+    if (cacheDir.empty()) {
+        file = scriptPath + ".scrc";
+    } else {
+        std::ostringstream name;
+        // the same source compiled with other options is another entry
+        name << std::hex << hash(reinterpret_cast<const char*>(&options), sizeof(options), sourceHash) << ".scrc";
+        file = cacheDir + "/" + name.str();
+    }
+}
+
+std::uint64_t Cache::hash(const char *source, std::size_t size, std::uint64_t seed) {
+    // FNV-1a
+    std::uint64_t val = seed;
+    for (std::size_t i = 0; i < size; ++i) {
+        val ^= static_cast<unsigned char>(source[i]);
+        val *= 1099511628211ull;
+    }
+    return val;
+}
+
+bool Cache::load(const Program &program, Module &module) const {
+    std::ifstream is(file, std::ios::binary);
+    if (!is)
+        return false;
+
+    try {
+        char header[sizeof(magic)];
+        if (!is.read(header, sizeof(header)) || !std::equal(header, header + sizeof(header), magic))
+            return false;
+
+        Reader in(is);
+        if (in.u32() != formatVersion || in.u32() != options || in.u64() != sourceHash)
+            return false;
+
+        Module loaded;
+        loaded.entry = in.u32();
+
+        loaded.natives.resize(in.count());
+        for (auto &native : loaded.natives) {
+            std::string name = in.str();
+            if (!program.existBuiltin(name))
+                return false;
+            native = &program.findBuiltin(name);
+        }
+
+        loaded.chunks.resize(in.count());
+        for (auto &chunk : loaded.chunks) {
+            chunk.name = in.str();
+            chunk.params = in.u32();
+            chunk.registers = in.u32();
+
+            chunk.code.resize(in.count());
+            for (auto &instruction : chunk.code) {
+                instruction.op = static_cast<OpCode>(in.u8());
+                instruction.a = in.u16();
+                instruction.b = in.u16();
+                instruction.c = in.u16();
+                if (instruction.op > OpCode::ReturnNone)
+                    return false;
+            }
+
+            chunk.positions.resize(in.count());
+            if (chunk.positions.size() != chunk.code.size())
+                return false;
+            for (auto &position : chunk.positions) {
+                position.line = in.u32();
+                position.chunk = in.u32();
+            }
+
+            chunk.constants.resize(in.count());
+            for (auto &constant : chunk.constants)
+                constant = in.var();
+        }
+
+        if (loaded.entry >= loaded.chunks.size())
+            return false;
+        for (auto &chunk : loaded.chunks) {
+            if (!valid(chunk, loaded))
+                return false;
+            for (auto &position : chunk.positions)
+                if (position.chunk >= loaded.chunks.size())
+                    return false;
+        }
+
+        // the unchecked forms aren't taken from the file but proven again,
+        // like Compiler does after inlining
+        for (auto &chunk : loaded.chunks) {
+            for (auto &instruction : chunk.code)
+                instruction.op = generic(instruction.op);
+            Types::specialize(chunk);
+            Bounds::specialize(chunk);
+        }
+        module = std::move(loaded);
+        return true;
+    } catch (std::runtime_error &) {
+        return false;
+    }
+}
+
+void Cache::store(const Module &module) const {
+    // written aside and renamed, so a concurrent run never sees half an
+    // entry; runs storing at once each write a file of their own
+    std::string tmp = util::tempName(file);
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        if (!os)
+            return;
+
+        os.write(magic, sizeof(magic));
+        Writer out(os);
+        out.u32(formatVersion);
+        out.u32(options);
+        out.u64(sourceHash);
+        out.u32(module.entry);
+
+        out.u32(module.natives.size());
+        for (auto native : module.natives)
+            out.str(native->name);
+
+        out.u32(module.chunks.size());
+        for (auto &chunk : module.chunks) {
+            out.str(chunk.name);
+            out.u32(chunk.params);
+            out.u32(chunk.registers);
+
+            out.u32(chunk.code.size());
+            for (auto &instruction : chunk.code) {
+                out.u8(static_cast<std::uint8_t>(instruction.op));
+                out.u16(instruction.a);
+                out.u16(instruction.b);
+                out.u16(instruction.c);
+            }
+
+            out.u32(chunk.positions.size());
+            for (auto &position : chunk.positions) {
+                out.u32(position.line);
+                out.u32(position.chunk);
+            }
+
+            out.u32(chunk.constants.size());
+            for (auto &constant : chunk.constants)
+                out.var(constant);
+        }
+
+        if (!os.flush()) {
+            os.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), file.c_str()) != 0)
+        std::remove(tmp.c_str());
+}
@@ -0,0 +1,53 @@
+#ifndef VM_CACHE_HPP_
+#define VM_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Bytecode.hpp"
+
+namespace ast
+{
+class Program;
+}
+
+namespace vm
+{
+
+// Compiled Module stored on disk, so running an unchanged script again
+// skips scanning, parsing and compiling. An entry is only used when the
+// hash of the source, the options it was compiled with and the format
+// version all match, and every operand in it is in range.
+class Cache
+{
+public:
+    // bump whenever Module, OpCode or the file layout changes
+    static const std::uint32_t formatVersion = 6;
+
+    // options bits, for anything that changes the code compiled
+    static const std::uint32_t optimized = 1;
+
+    // entry next to the script, or named after the hash inside cacheDir
+    Cache(const std::string &scriptPath, const std::string &cacheDir, std::uint64_t sourceHash,
+          std::uint32_t options);
+
+    // pass the previous result as seed to hash several sources together
+    static std::uint64_t hash(const char *source, std::size_t size, std::uint64_t seed = 14695981039346656037ull);
+
+    // builtins referenced by the module are looked up in program by name;
+    // false when there's no usable entry
+    bool load(const ast::Program &program, Module &module) const;
+    // best effort, a cache that can't be written is just not used
+    void store(const Module &module) const;
+
+    const std::string& path() const { return file; }
+
+private:
+    std::string file;
+    std::uint64_t sourceHash;
+    std::uint32_t options;
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+#include "Compiler.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include "Bounds.hpp"
+#include "Inliner.hpp"
+#include "Types.hpp"
+#include "../ast/Program.hpp"
+#include "../ast/expression/Expression.hpp"
+
+using namespace vm;
+using namespace ast;
+
+namespace
+{
+
+std::uint16_t narrow(size_t value) {
+    if (value > std::numeric_limits<std::uint16_t>::max())
+        throw std::runtime_error("Function too large for bytecode");
+    return static_cast<std::uint16_t>(value);
+}
+
+}
+
+Module Compiler::compile(Program &program) {
+    if (!program.existFunction("main"))
+        throw std::runtime_error("Program doesn't contain main function");
+
+    return compile(program.findFunction("main"));
+}
+
+Module Compiler::compile(FunctionDefinition &entry) {
+    module = Module();
+    functions.clear();
+    pending.clear();
+    natives.clear();
+    module.entry = function(entry);
+
+    while (!pending.empty()) {
+        FunctionDefinition *def = pending.front();
+        pending.pop_front();
+
+        Chunk target;
+        compileFunction(*def, target);
+
+        unsigned idx = functions.at(def);
+        if (module.chunks.size() <= idx)
+            module.chunks.resize(idx + 1);
+        module.chunks[idx] = std::move(target);
+    }
+
+    // inlined code is specialized for the registers of its caller
+    Inliner::run(module);
+    for (auto &chunk : module.chunks) {
+        Types::specialize(chunk);
+        Bounds::specialize(chunk);
+    }
+
+    return std::move(module);
+}
+
+void Compiler::compileFunction(FunctionDefinition &function, Chunk &target) {
+    chunk = &target;
+    position = Position{0, functions.at(&function)};
+    next = function.frameSize();
+    loops.clear();
+
+    target.name = function.getId();
+    target.params = function.size();
+    target.registers = next;
+
+    statement(function.getFunctionBlock());
+    emit(OpCode::ReturnNone);
+    chunk = nullptr;
+}
+
+size_t Compiler::emit(OpCode op, unsigned a, unsigned b, unsigned c) {
+    chunk->code.push_back(Instruction{op, narrow(a), narrow(b), narrow(c)});
+    chunk->positions.push_back(position);
+    return chunk->code.size() - 1;
+}
+
+void Compiler::patch(size_t jump, size_t target) {
+    chunk->code.at(jump).b = narrow(target);
+}
+
+void Compiler::statement(const Statement &stmt) {
+    unsigned top = next;
+    std::uint32_t line = position.line;
+    if (stmt.getLine() > 0)
+        position.line = stmt.getLine();
+    stmt.compile(*this);
+    position.line = line;
+    next = top;
+}
+
+unsigned Compiler::operand(const Expression &expr) {
+    if (const Slot *slot = expr.directVariable())
+        return variable(*slot);
+
+    unsigned dst = temp();
+    expr.compile(*this, dst);
+    return dst;
+}
+
+unsigned Compiler::temp() {
+    unsigned reg = next++;
+    if (next > chunk->registers)
+        chunk->registers = next;
+    narrow(reg);
+    return reg;
+}
+
+unsigned Compiler::variable(Slot slot) const {
+    return slot.index;
+}
+
+unsigned Compiler::constant(const Var &value) {
+    chunk->constants.push_back(value);
+    return narrow(chunk->constants.size() - 1);
+}
+
+unsigned Compiler::function(FunctionDefinition &function) {
+    auto it = functions.find(&function);
+    if (it != functions.end())
+        return it->second;
+
+    unsigned idx = functions.size();
+    functions.insert({&function, idx});
+    pending.push_back(&function);
+    return idx;
+}
+
+unsigned Compiler::native(const Builtin &builtin) {
+    auto it = natives.find(&builtin);
+    if (it != natives.end())
+        return it->second;
+
+    unsigned idx = module.natives.size();
+    natives.insert({&builtin, idx});
+    module.natives.push_back(&builtin);
+    return idx;
+}
+
+void Compiler::beginLoop(size_t continueTarget) {
+    loops.push_back(Loop{continueTarget, {}});
+}
+
+void Compiler::endLoop(size_t breakTarget) {
+    for (auto jump : loops.back().breaks)
+        patch(jump, breakTarget);
+    loops.pop_back();
+}
+
+void Compiler::emitBreak() {
+    // break outside of a loop leaves the function, like the tree-walker does
+    if (loops.empty())
+        emit(OpCode::ReturnNone);
+    else
+        loops.back().breaks.push_back(emit(OpCode::Jump));
+}
+
+void Compiler::emitContinue() {
+    if (loops.empty())
+        emit(OpCode::ReturnNone);
+    else
+        emit(OpCode::Jump, 0, loops.back().continueTarget);
+}
@@ -0,0 +1,73 @@
+#ifndef VM_COMPILER_HPP_
+#define VM_COMPILER_HPP_
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Bytecode.hpp"
+
+namespace ast
+{
+class Var;
+struct Slot;
+struct Builtin;
+class Expression;
+class Statement;
+class FunctionDefinition;
+class Program;
+}
+
+namespace vm
+{
+
+// Translates the AST of a Program into a Module. Every function reachable
+// from main gets its own Chunk; frame slots of the function are its first
+// registers, temporaries follow them.
+class Compiler
+{
+public:
+    Module compile(ast::Program &program);
+    // module whose entry is function, with everything it calls
+    Module compile(ast::FunctionDefinition &function);
+
+    size_t emit(OpCode op, unsigned a = 0, unsigned b = 0, unsigned c = 0);
+    size_t label() const { return chunk->code.size(); }
+    void patch(size_t jump, size_t target);
+
+    void statement(const ast::Statement &stmt);
+    unsigned operand(const ast::Expression &expr);
+
+    unsigned temp();
+    unsigned variable(ast::Slot slot) const;
+    unsigned constant(const ast::Var &value);
+    unsigned function(ast::FunctionDefinition &function);
+    unsigned native(const ast::Builtin &builtin);
+
+    void beginLoop(size_t continueTarget);
+    void endLoop(size_t breakTarget);
+    void emitBreak();
+    void emitContinue();
+
+private:
+    struct Loop {
+        size_t continueTarget;
+        std::vector<size_t> breaks;
+    };
+
+    void compileFunction(ast::FunctionDefinition &function, Chunk &target);
+
+    Module module;
+    Chunk* chunk = nullptr;
+    // of the statement being compiled
+    Position position{0, 0};
+    unsigned next = 0;
+    std::unordered_map<const ast::FunctionDefinition*, unsigned> functions;
+    std::list<ast::FunctionDefinition*> pending;
+    std::unordered_map<const ast::Builtin*, unsigned> natives;
+    std::vector<Loop> loops;
+};
+
+}
+
+#endif
@@ -0,0 +1,286 @@
+#include "Inliner.hpp"
+
+#include <limits>
+
+using namespace vm;
+
+namespace
+{
+
+const size_t maxRegisters = std::numeric_limits<std::uint16_t>::max();
+
+bool isJump(OpCode op) {
+    return op == OpCode::Jump || op == OpCode::JumpIfFalse || op == OpCode::JumpIfTrue;
+}
+
+// registers the instruction reads, by calling read(reg)
+template <typename Read>
+void reads(const Module &module, const Instruction &in, Read read) {
+    switch (in.op) {
+        case OpCode::LoadConst:
+        case OpCode::Jump:
+        case OpCode::Step:
+        case OpCode::ReturnNone:
+            break;
+        case OpCode::Move:
+        case OpCode::Neg:
+        case OpCode::Not:
+        case OpCode::Len:
+            read(in.b);
+            break;
+        case OpCode::Slice:
+            read(in.b);
+            read(in.c);
+            read(in.c + 1);
+            break;
+        case OpCode::StoreIndex:
+        case OpCode::StoreIndexInBounds:
+            read(in.a);
+            read(in.b);
+            read(in.c);
+            break;
+        case OpCode::Append:
+            read(in.a);
+            read(in.b);
+            break;
+        case OpCode::JumpIfFalse:
+        case OpCode::JumpIfTrue:
+        case OpCode::Return:
+            read(in.a);
+            break;
+        case OpCode::Call:
+            for (unsigned i = 0; i < module.chunks[in.b].params; ++i)
+                read(in.c + i);
+            break;
+        case OpCode::CallNative:
+            for (unsigned i = 0; i < module.natives[in.b]->arity; ++i)
+                read(in.c + i);
+            break;
+        default:
+            read(in.b);
+            read(in.c);
+            break;
+    }
+}
+
+bool writes(const Instruction &in) {
+    return !isJump(in.op) && in.op != OpCode::StoreIndex && in.op != OpCode::StoreIndexInBounds
+           && in.op != OpCode::Step && in.op != OpCode::Return && in.op != OpCode::ReturnNone;
+}
+
+// registers some path may read before writing them, which have to start
+// as () like they do in a fresh frame; parameters never do
+std::vector<bool> uninitialized(const Module &module, const Chunk &chunk) {
+    size_t n = chunk.code.size();
+    std::vector<bool> result(chunk.registers, false);
+    std::vector<std::vector<bool>> before(n);
+    std::vector<size_t> work;
+    before[0].assign(chunk.registers, false);
+    for (unsigned reg = 0; reg < chunk.params; ++reg)
+        before[0][reg] = true;
+    work.push_back(0);
+
+    // written on every path to target
+    auto flow = [&](size_t target, const std::vector<bool> &state) {
+        if (target >= n)
+            return;
+        std::vector<bool> &into = before[target];
+        bool changed = into.empty();
+        if (changed) {
+            into = state;
+        } else {
+            for (unsigned reg = 0; reg < chunk.registers; ++reg) {
+                if (into[reg] && !state[reg]) {
+                    into[reg] = false;
+                    changed = true;
+                }
+            }
+        }
+        if (changed)
+            work.push_back(target);
+    };
+
+    while (!work.empty()) {
+        size_t pc = work.back();
+        work.pop_back();
+
+        const Instruction &in = chunk.code[pc];
+        std::vector<bool> state = before[pc];
+        reads(module, in, [&](unsigned reg) {
+            if (reg < chunk.registers && !state[reg])
+                result[reg] = true;
+        });
+        if (writes(in))
+            state[in.a] = true;
+
+        if (in.op == OpCode::Jump) {
+            flow(in.b, state);
+        } else if (isJump(in.op)) {
+            flow(in.b, state);
+            flow(pc + 1, state);
+        } else if (in.op != OpCode::Return && in.op != OpCode::ReturnNone) {
+            flow(pc + 1, state);
+        }
+    }
+    return result;
+}
+
+struct Callee {
+    bool small = false;
+    std::vector<bool> cleared;
+};
+
+class Splicer
+{
+public:
+    Splicer(const std::vector<Chunk> &original_, const std::vector<Callee> &callees_)
+        : original(original_), callees(callees_) {}
+
+    // self is the index of chunk
+    void run(Chunk &chunk, unsigned self) {
+        code.clear();
+        positions.clear();
+        std::vector<size_t> at(chunk.code.size() + 1);
+        // jumps of the caller itself, whose targets are still old positions
+        std::vector<size_t> ownJumps;
+        unsigned none = 0;
+        bool noneAdded = false;
+
+        for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+            at[pc] = code.size();
+            const Instruction &in = chunk.code[pc];
+            if (in.op != OpCode::Call || in.b == self || !fits(chunk, in.b, code.size())) {
+                if (isJump(in.op))
+                    ownJumps.push_back(code.size());
+                add(in, where(chunk, pc));
+                continue;
+            }
+
+            if (!noneAdded) {
+                none = chunk.constants.size();
+                chunk.constants.emplace_back();
+                noneAdded = true;
+            }
+            copy(chunk, in, where(chunk, pc), none);
+        }
+        at[chunk.code.size()] = code.size();
+
+        for (auto idx : ownJumps)
+            code[idx].b = static_cast<std::uint16_t>(at[code[idx].b]);
+        chunk.code = std::move(code);
+        chunk.positions = std::move(positions);
+    }
+
+private:
+    bool fits(const Chunk &chunk, unsigned callee, size_t size) const {
+        const Chunk &body = original[callee];
+        return callees[callee].small && chunk.registers + body.registers <= maxRegisters
+               && size + chunk.code.size() + 1 + body.registers + 2 * body.code.size() <= Inliner::maxGrowth;
+    }
+
+    static Position where(const Chunk &chunk, size_t pc) {
+        return pc < chunk.positions.size() ? chunk.positions[pc] : Position{0, 0};
+    }
+
+    void add(const Instruction &in, const Position &position) {
+        code.push_back(in);
+        positions.push_back(position);
+    }
+
+    // the callee's code in place of call, which is at
+    void copy(Chunk &chunk, const Instruction &call, const Position &at, unsigned none) {
+        const Chunk &body = original[call.b];
+        unsigned base = chunk.registers;
+        unsigned constants = chunk.constants.size();
+        chunk.registers += body.registers;
+        chunk.constants.insert(chunk.constants.end(), body.constants.begin(), body.constants.end());
+
+        auto reg = [base](unsigned r) { return static_cast<std::uint16_t>(base + r); };
+        // the call still counts towards the budget, like it does run by
+        // the tree-walker
+        add(Instruction{OpCode::Step, 0, 0, 0}, at);
+        for (unsigned i = 0; i < body.params; ++i)
+            add(Instruction{OpCode::Move, reg(i), static_cast<std::uint16_t>(call.c + i), 0}, at);
+        const std::vector<bool> &cleared = callees[call.b].cleared;
+        for (unsigned r = body.params; r < body.registers; ++r)
+            if (cleared[r])
+                add(Instruction{OpCode::LoadConst, reg(r), static_cast<std::uint16_t>(none), 0}, at);
+
+        std::vector<size_t> moved(body.code.size() + 1);
+        std::vector<size_t> jumps, exits;
+        for (size_t pc = 0; pc < body.code.size(); ++pc) {
+            moved[pc] = code.size();
+            Instruction in = body.code[pc];
+            Position position = where(body, pc);
+            switch (in.op) {
+                case OpCode::Return:
+                    add(Instruction{OpCode::Move, call.a, reg(in.a), 0}, position);
+                    exits.push_back(code.size());
+                    add(Instruction{OpCode::Jump, 0, 0, 0}, position);
+                    continue;
+                case OpCode::ReturnNone:
+                    add(Instruction{OpCode::LoadConst, call.a, static_cast<std::uint16_t>(none), 0}, position);
+                    exits.push_back(code.size());
+                    add(Instruction{OpCode::Jump, 0, 0, 0}, position);
+                    continue;
+                case OpCode::Jump:
+                    jumps.push_back(code.size());
+                    break;
+                case OpCode::JumpIfFalse:
+                case OpCode::JumpIfTrue:
+                    in.a = reg(in.a);
+                    jumps.push_back(code.size());
+                    break;
+                case OpCode::LoadConst:
+                    in.a = reg(in.a);
+                    in.b = static_cast<std::uint16_t>(constants + in.b);
+                    break;
+                case OpCode::Step:
+                    break;
+                case OpCode::Call:
+                case OpCode::CallNative:
+                    in.a = reg(in.a);
+                    in.c = reg(in.c);
+                    break;
+                default:
+                    in.a = reg(in.a);
+                    in.b = reg(in.b);
+                    in.c = reg(in.c);
+                    break;
+            }
+            add(in, position);
+        }
+        moved[body.code.size()] = code.size();
+
+        for (auto idx : jumps)
+            code[idx].b = static_cast<std::uint16_t>(moved[code[idx].b]);
+        for (auto idx : exits)
+            code[idx].b = static_cast<std::uint16_t>(code.size());
+    }
+
+    const std::vector<Chunk> &original;
+    const std::vector<Callee> &callees;
+    // the caller being rewritten
+    std::vector<Instruction> code;
+    std::vector<Position> positions;
+};
+
+}
+
+void Inliner::run(Module &module) {
+    // every caller copies the callees as they were compiled, so nothing is
+    // inlined into itself through another chunk
+    const std::vector<Chunk> original = module.chunks;
+    std::vector<Callee> callees(original.size());
+    for (unsigned i = 0; i < original.size(); ++i) {
+        const Chunk &chunk = original[i];
+        if (chunk.code.empty() || chunk.code.size() > maxSize)
+            continue;
+        callees[i].small = true;
+        callees[i].cleared = uninitialized(module, chunk);
+    }
+
+    Splicer splicer(original, callees);
+    for (unsigned i = 0; i < module.chunks.size(); ++i)
+        splicer.run(module.chunks[i], i);
+}
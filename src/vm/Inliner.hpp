@@ -0,0 +1,29 @@
+#ifndef VM_INLINER_HPP_
+#define VM_INLINER_HPP_
+
+#include <cstddef>
+#include "Bytecode.hpp"
+
+namespace vm
+{
+
+// Replaces calls to small chunks by a copy of their code. The callee gets
+// registers of its own after the caller's: the arguments are moved there,
+// its variables cleared, and its returns store into the call's destination
+// and jump past the copy. Calls the copy makes stay calls, so recursion
+// doesn't grow anything. An inlined call is still a budget step, a Step
+// instruction ahead of the copy, but no Stats entry of its own any more.
+class Inliner
+{
+public:
+    // callees of at most maxSize instructions are copied
+    static const size_t maxSize = 32;
+    // callers stop growing at maxGrowth instructions
+    static const size_t maxGrowth = 4096;
+
+    static void run(Module &module);
+};
+
+}
+
+#endif
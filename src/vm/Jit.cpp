@@ -0,0 +1,521 @@
+#include "Jit.hpp"
+
+#include <cstring>
+#include <sys/mman.h>
+#include "Assembler.hpp"
+
+using namespace vm;
+using namespace ast;
+
+namespace
+{
+
+// a register: the value in the low half, 1 in the high half for a scalar
+// and 0 for (), whose value is then 0 as well
+typedef std::uint64_t Cell;
+const Cell scalar = 1ull << 32;
+
+// registers of the native frames of one thread, and the depth of the calls
+const unsigned stackCells = 1u << 18;
+const unsigned maxDepth = 100000;
+
+typedef int (*Stub)(Cell *regs, Cell *limit, const void *target, Cell *result);
+
+Cell* cellStack() {
+    thread_local std::vector<Cell> cells(stackCells);
+    return cells.data();
+}
+
+bool toCell(const Var &var, Cell &cell) {
+    if (var.value.size() > 1)
+        return false;
+    cell = var.value.empty() ? 0 : scalar | static_cast<std::uint32_t>(var.value[0]);
+    return true;
+}
+
+Var fromCell(Cell cell) {
+    if (!(cell & scalar))
+        return Var();
+    return Var(VarType::INT, valueVec(1, static_cast<possibleValue>(static_cast<std::uint32_t>(cell))));
+}
+
+int value(unsigned reg) { return 8 * reg; }
+int flag(unsigned reg) { return 8 * reg + 4; }
+
+bool isJump(OpCode op) {
+    return op == OpCode::Jump || op == OpCode::JumpIfFalse || op == OpCode::JumpIfTrue;
+}
+
+bool scalarOnly(const Chunk &chunk) {
+    if (chunk.code.empty())
+        return false;
+    for (auto &in : chunk.code) {
+        switch (in.op) {
+            case OpCode::Index:
+            case OpCode::Slice:
+            case OpCode::StoreIndex:
+            case OpCode::IndexInBounds:
+            case OpCode::StoreIndexInBounds:
+            case OpCode::Len:
+            case OpCode::Append:
+            case OpCode::CallNative:
+                return false;
+            case OpCode::LoadConst:
+                if (chunk.constants[in.b].value.size() > 1)
+                    return false;
+                break;
+            default:
+                if (isJump(in.op) && in.b >= chunk.code.size())
+                    return false;
+                break;
+        }
+    }
+    return true;
+}
+
+// chunks that qualify, and whose callees all qualify too
+std::vector<bool> eligible(const Module &module) {
+    std::vector<bool> ok;
+    for (auto &chunk : module.chunks)
+        ok.push_back(scalarOnly(chunk));
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (unsigned i = 0; i < module.chunks.size(); ++i) {
+            if (!ok[i])
+                continue;
+            for (auto &in : module.chunks[i].code) {
+                if (in.op == OpCode::Call && !ok[in.b]) {
+                    ok[i] = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// Native code of one chunk. rbx points at its registers, r12 at the end
+// of the cell stack and r13 counts the calls that may still be nested;
+// a chunk returns 0 in eax and its value in rdx, or 1 when it gives up.
+class Translator
+{
+public:
+    struct Call {
+        size_t at;
+        unsigned chunk;
+    };
+
+    Translator(Assembler &as_, const Module &module_, std::vector<Call> &calls_)
+        : as(as_), module(module_), calls(calls_) {}
+
+    // returns the number of cells of the frame; positions of the start and
+    // of every instruction go to start and pcs
+    unsigned translate(const Chunk &chunk, size_t &start, std::vector<size_t> &pcs) {
+        size_t n = chunk.code.size();
+        cells = chunk.registers;
+
+        start = as.position();
+        as.lea64(Reg::rax, value(cells));
+        as.cmp64(Reg::rax, Reg::r12);
+        bail(as.jcc(Cond::A));
+        as.xor32(Reg::rax, Reg::rax);
+        for (unsigned reg = chunk.params; reg < cells; ++reg)
+            as.store64(value(reg), Reg::rax);
+
+        std::vector<size_t> entry(n);
+        for (size_t pc = 0; pc < n; ++pc) {
+            entry[pc] = as.position();
+            instruction(chunk, chunk.code[pc]);
+        }
+
+        size_t bailout = as.position();
+        as.mov32(Reg::rax, 1u);
+        as.ret();
+        for (auto at : bails)
+            as.patch(at, bailout);
+        for (auto &jump : jumps)
+            as.patch(jump.at, entry[jump.target]);
+
+        pcs = std::move(entry);
+        bails.clear();
+        jumps.clear();
+        return cells;
+    }
+
+private:
+    struct Jump {
+        size_t at;
+        size_t target;
+    };
+
+    void bail(size_t at) { bails.push_back(at); }
+    void jump(size_t at, size_t target) { jumps.push_back(Jump{at, target}); }
+
+    // both halves of register a from eax
+    void storeBool(unsigned a) {
+        as.store32(value(a), Reg::rax);
+        as.store32(flag(a), Reg::rax);
+    }
+
+    // eax = x < y, by Var's rules for () and scalars
+    void less(unsigned x, unsigned y) {
+        as.load32(Reg::rax, flag(x));
+        as.load32(Reg::rdx, flag(y));
+        as.mov32(Reg::rcx, Reg::rax);
+        as.and32(Reg::rcx, Reg::rdx);
+        size_t notBoth = as.jcc(Cond::E);
+        as.load32(Reg::rcx, value(x));
+        as.cmp32(Reg::rcx, value(y));
+        as.setcc(Cond::L);
+        size_t done = as.jmp();
+        as.patch(notBoth, as.position());
+        as.cmp32(Reg::rax, Reg::rdx);
+        as.setcc(Cond::B);
+        as.patch(done, as.position());
+    }
+
+    static Cond compare(OpCode op) {
+        switch (op) {
+            case OpCode::EqInt: return Cond::E;
+            case OpCode::NeInt: return Cond::NE;
+            case OpCode::LtInt: return Cond::L;
+            case OpCode::GtInt: return Cond::G;
+            case OpCode::LeInt: return Cond::LE;
+            default: return Cond::GE;
+        }
+    }
+
+    void instruction(const Chunk &chunk, const Instruction &in) {
+        switch (in.op) {
+            case OpCode::LoadConst: {
+                Cell cell = 0;
+                toCell(chunk.constants[in.b], cell);
+                as.mov64(Reg::rax, cell);
+                as.store64(value(in.a), Reg::rax);
+                break;
+            }
+            case OpCode::Move:
+                as.load64(Reg::rax, value(in.b));
+                as.store64(value(in.a), Reg::rax);
+                break;
+            case OpCode::Neg:
+                as.load32(Reg::rax, value(in.b));
+                as.load32(Reg::rcx, flag(in.b));
+                as.neg32(Reg::rax);
+                as.store32(value(in.a), Reg::rax);
+                as.store32(flag(in.a), Reg::rcx);
+                break;
+            case OpCode::Not:
+                as.load32(Reg::rax, flag(in.b));
+                as.xorImm(Reg::rax, 1);
+                storeBool(in.a);
+                break;
+            case OpCode::Add:
+            case OpCode::Sub:
+                // sizes have to match
+                as.load32(Reg::rax, flag(in.b));
+                as.cmp32(Reg::rax, flag(in.c));
+                bail(as.jcc(Cond::NE));
+                as.load32(Reg::rcx, value(in.b));
+                if (in.op == OpCode::Add)
+                    as.add32(Reg::rcx, value(in.c));
+                else
+                    as.sub32(Reg::rcx, value(in.c));
+                as.store32(value(in.a), Reg::rcx);
+                as.store32(flag(in.a), Reg::rax);
+                break;
+            case OpCode::Mul:
+                // one side has to be a scalar, the result has the other's size
+                as.load32(Reg::rax, flag(in.b));
+                as.load32(Reg::rdx, flag(in.c));
+                as.mov32(Reg::rcx, Reg::rax);
+                as.or32(Reg::rcx, Reg::rdx);
+                bail(as.jcc(Cond::E));
+                as.and32(Reg::rax, Reg::rdx);
+                as.load32(Reg::rcx, value(in.b));
+                as.imul32(Reg::rcx, value(in.c));
+                as.store32(value(in.a), Reg::rcx);
+                as.store32(flag(in.a), Reg::rax);
+                break;
+            case OpCode::Div: {
+                // the divisor has to be a scalar, and not 0 unless the
+                // dividend is (); x / -1 wraps instead of trapping
+                as.cmpImm(flag(in.c), 0);
+                bail(as.jcc(Cond::E));
+                as.load32(Reg::rax, flag(in.b));
+                as.test32(Reg::rax, Reg::rax);
+                size_t empty = as.jcc(Cond::E);
+                as.load32(Reg::rcx, value(in.c));
+                as.test32(Reg::rcx, Reg::rcx);
+                bail(as.jcc(Cond::E));
+                as.load32(Reg::rax, value(in.b));
+                as.cmpImm(Reg::rcx, -1);
+                size_t negate = as.jcc(Cond::E);
+                as.cdq();
+                as.idiv32(Reg::rcx);
+                size_t store = as.jmp();
+                as.patch(negate, as.position());
+                as.neg32(Reg::rax);
+                as.patch(store, as.position());
+                as.store32(value(in.a), Reg::rax);
+                as.storeImm32(flag(in.a), 1);
+                size_t done = as.jmp();
+                as.patch(empty, as.position());
+                as.storeImm64(value(in.a), 0);
+                as.patch(done, as.position());
+                break;
+            }
+            case OpCode::Eq:
+            case OpCode::Ne:
+                // both halves are equal exactly when the values are
+                as.load64(Reg::rax, value(in.b));
+                as.cmp64(Reg::rax, value(in.c));
+                as.setcc(in.op == OpCode::Eq ? Cond::E : Cond::NE);
+                storeBool(in.a);
+                break;
+            case OpCode::Lt:
+                less(in.b, in.c);
+                storeBool(in.a);
+                break;
+            case OpCode::Gt:
+                less(in.c, in.b);
+                storeBool(in.a);
+                break;
+            case OpCode::Le:
+                less(in.c, in.b);
+                as.xorImm(Reg::rax, 1);
+                storeBool(in.a);
+                break;
+            case OpCode::Ge:
+                less(in.b, in.c);
+                as.xorImm(Reg::rax, 1);
+                storeBool(in.a);
+                break;
+            case OpCode::And:
+                as.load32(Reg::rax, flag(in.b));
+                as.and32(Reg::rax, flag(in.c));
+                storeBool(in.a);
+                break;
+            case OpCode::Or:
+                as.load32(Reg::rax, flag(in.b));
+                as.or32(Reg::rax, flag(in.c));
+                storeBool(in.a);
+                break;
+
+            // both operands are scalars, so no flags to check
+            case OpCode::AddInt:
+            case OpCode::SubInt:
+            case OpCode::MulInt:
+                as.load32(Reg::rcx, value(in.b));
+                if (in.op == OpCode::AddInt)
+                    as.add32(Reg::rcx, value(in.c));
+                else if (in.op == OpCode::SubInt)
+                    as.sub32(Reg::rcx, value(in.c));
+                else
+                    as.imul32(Reg::rcx, value(in.c));
+                as.store32(value(in.a), Reg::rcx);
+                as.storeImm32(flag(in.a), 1);
+                break;
+            case OpCode::DivInt: {
+                as.load32(Reg::rcx, value(in.c));
+                as.test32(Reg::rcx, Reg::rcx);
+                bail(as.jcc(Cond::E));
+                as.load32(Reg::rax, value(in.b));
+                as.cmpImm(Reg::rcx, -1);
+                size_t negate = as.jcc(Cond::E);
+                as.cdq();
+                as.idiv32(Reg::rcx);
+                size_t store = as.jmp();
+                as.patch(negate, as.position());
+                as.neg32(Reg::rax);
+                as.patch(store, as.position());
+                as.store32(value(in.a), Reg::rax);
+                as.storeImm32(flag(in.a), 1);
+                break;
+            }
+            case OpCode::EqInt:
+            case OpCode::NeInt:
+            case OpCode::LtInt:
+            case OpCode::GtInt:
+            case OpCode::LeInt:
+            case OpCode::GeInt:
+                as.load32(Reg::rcx, value(in.b));
+                as.cmp32(Reg::rcx, value(in.c));
+                as.setcc(compare(in.op));
+                storeBool(in.a);
+                break;
+
+            case OpCode::Jump:
+                jump(as.jmp(), in.b);
+                break;
+            case OpCode::JumpIfFalse:
+            case OpCode::JumpIfTrue:
+                as.cmpImm(flag(in.a), 0);
+                jump(as.jcc(in.op == OpCode::JumpIfFalse ? Cond::E : Cond::NE), in.b);
+                break;
+
+            case OpCode::Call: {
+                // the callee's frame follows this one
+                const Chunk &callee = module.chunks[in.b];
+                as.lea64(Reg::rax, value(cells + callee.params));
+                as.cmp64(Reg::rax, Reg::r12);
+                bail(as.jcc(Cond::A));
+                for (unsigned i = 0; i < callee.params; ++i) {
+                    as.load64(Reg::rax, value(in.c + i));
+                    as.store64(value(cells + i), Reg::rax);
+                }
+                as.dec64(Reg::r13);
+                bail(as.jcc(Cond::E));
+                as.add64(Reg::rbx, value(cells));
+                calls.push_back(Call{as.call(), in.b});
+                as.sub64(Reg::rbx, value(cells));
+                as.inc64(Reg::r13);
+                as.test32(Reg::rax, Reg::rax);
+                bail(as.jcc(Cond::NE));
+                as.store64(value(in.a), Reg::rdx);
+                break;
+            }
+            case OpCode::Return:
+                as.load64(Reg::rdx, value(in.a));
+                as.xor32(Reg::rax, Reg::rax);
+                as.ret();
+                break;
+            case OpCode::ReturnNone:
+                as.xor32(Reg::rdx, Reg::rdx);
+                as.xor32(Reg::rax, Reg::rax);
+                as.ret();
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    Assembler &as;
+    const Module &module;
+    std::vector<Call> &calls;
+    unsigned cells = 0;
+    std::vector<size_t> bails;
+    std::vector<Jump> jumps;
+};
+
+// Stub(regs, limit, target, result): saves what the native code uses,
+// calls target and stores the value it returned
+void emitStub(Assembler &as) {
+    as.push(Reg::rbx);
+    as.push(Reg::r12);
+    as.push(Reg::r13);
+    as.push(Reg::r14);
+    as.sub64(Reg::rsp, 8);
+    as.mov64(Reg::r14, Reg::rcx);
+    as.mov64(Reg::rbx, Reg::rdi);
+    as.mov64(Reg::r12, Reg::rsi);
+    as.mov32(Reg::r13, maxDepth);
+    as.call(Reg::rdx);
+    as.storeAt(Reg::r14, Reg::rdx);
+    as.add64(Reg::rsp, 8);
+    as.pop(Reg::r14);
+    as.pop(Reg::r13);
+    as.pop(Reg::r12);
+    as.pop(Reg::rbx);
+    as.ret();
+}
+
+}
+
+std::unique_ptr<Jit> Jit::compile(const Module &module) {
+    std::unique_ptr<Jit> jit(new Jit());
+#if defined(__x86_64__)
+    std::vector<bool> ok = eligible(module);
+
+    Assembler as;
+    emitStub(as);
+
+    std::vector<Translator::Call> calls;
+    Translator translator(as, module, calls);
+    std::vector<size_t> starts(module.chunks.size());
+    std::vector<std::vector<size_t>> pcs(module.chunks.size());
+    std::vector<unsigned> cells(module.chunks.size());
+    for (unsigned i = 0; i < module.chunks.size(); ++i)
+        if (ok[i])
+            cells[i] = translator.translate(module.chunks[i], starts[i], pcs[i]);
+    for (auto &call : calls)
+        as.patch(call.at, starts[call.chunk]);
+
+    // native code is never writable and executable at once
+    size_t size = as.bytes().size();
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return jit;
+    std::memcpy(memory, as.bytes().data(), size);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return jit;
+    }
+    jit->memory = memory;
+    jit->size = size;
+
+    const std::uint8_t *base = static_cast<const std::uint8_t*>(memory);
+    jit->stub = base;
+    jit->entries.resize(module.chunks.size());
+    for (unsigned i = 0; i < module.chunks.size(); ++i) {
+        if (!ok[i])
+            continue;
+        Entry &entry = jit->entries[i];
+        entry.start = base + starts[i];
+        for (auto pc : pcs[i])
+            entry.pcs.push_back(base + pc);
+        entry.params = module.chunks[i].params;
+        entry.registers = module.chunks[i].registers;
+        entry.cells = cells[i];
+    }
+#else
+    (void) module;
+#endif
+    return jit;
+}
+
+Jit::~Jit() {
+    if (memory != nullptr)
+        munmap(memory, size);
+}
+
+bool Jit::call(unsigned chunk, const Var *args, Var &result) const {
+    if (!compiled(chunk))
+        return false;
+
+    const Entry &entry = entries[chunk];
+    Cell *regs = cellStack();
+    for (unsigned i = 0; i < entry.params; ++i)
+        if (!toCell(args[i], regs[i]))
+            return false;
+    return enter(entry.start, regs, result);
+}
+
+bool Jit::resume(unsigned chunk, size_t pc, const Var *regs, Var &result) const {
+    if (!compiled(chunk) || pc >= entries[chunk].pcs.size() || entries[chunk].cells > stackCells)
+        return false;
+
+    // past the prologue, so the frame is set up here
+    const Entry &entry = entries[chunk];
+    Cell *cells = cellStack();
+    for (unsigned i = 0; i < entry.registers; ++i)
+        if (!toCell(regs[i], cells[i]))
+            return false;
+    for (unsigned i = entry.registers; i < entry.cells; ++i)
+        cells[i] = 0;
+    return enter(entry.pcs[pc], cells, result);
+}
+
+bool Jit::enter(const std::uint8_t *target, Cell *regs, Var &result) const {
+    Cell *stack = cellStack();
+    Cell value = 0;
+    Stub run = reinterpret_cast<Stub>(const_cast<std::uint8_t*>(stub));
+    if (run(regs, stack + stackCells, target, &value) != 0)
+        return false;
+    result = fromCell(value);
+    return true;
+}
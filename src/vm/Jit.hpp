@@ -0,0 +1,65 @@
+#ifndef VM_JIT_HPP_
+#define VM_JIT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Bytecode.hpp"
+
+namespace vm
+{
+
+// Native x86-64 code for the chunks of a Module that only work on scalars:
+// no indexing, slicing, len, append or builtins, constants of at most one
+// value, and calls only to chunks like that. A register is kept unboxed as
+// a 32-bit value next to a flag telling () from a scalar, which is all
+// such a chunk can hold.
+//
+// Native code never throws. Whatever would fail in Var (sizes that don't
+// match, division by 0) or hit a limit makes it give up and return false;
+// as functions can't touch their caller's variables, the caller just runs
+// the same call in the interpreter, which gets the same result or error.
+class Jit
+{
+public:
+    // calls and loop iterations after which a function is worth compiling
+    static const unsigned hotCalls = 50;
+    static const unsigned hotLoops = 1000;
+    // failed runs after which a chunk stays interpreted
+    static const unsigned maxFailures = 4;
+
+    static std::unique_ptr<Jit> compile(const Module &module);
+
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+    ~Jit();
+
+    bool compiled(unsigned chunk) const { return chunk < entries.size() && entries[chunk].start != nullptr; }
+
+    // runs chunk with its parameters in args
+    bool call(unsigned chunk, const ast::Var *args, ast::Var &result) const;
+    // continues chunk at pc with its registers in regs
+    bool resume(unsigned chunk, size_t pc, const ast::Var *regs, ast::Var &result) const;
+
+private:
+    struct Entry {
+        const std::uint8_t *start = nullptr;
+        std::vector<const std::uint8_t*> pcs;
+        unsigned params = 0;
+        unsigned registers = 0;
+        unsigned cells = 0;
+    };
+
+    Jit() = default;
+    bool enter(const std::uint8_t *target, std::uint64_t *regs, ast::Var &result) const;
+
+    std::vector<Entry> entries;
+    const std::uint8_t *stub = nullptr;
+    void *memory = nullptr;
+    size_t size = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "Types.hpp"
+
+using namespace vm;
+
+namespace
+{
+
+typedef std::vector<bool> State;
+
+// state after in, from the state before it
+void transfer(const Chunk &chunk, const Instruction &in, State &state) {
+    switch (in.op) {
+        case OpCode::LoadConst:
+            state[in.a] = chunk.constants[in.b].value.size() == 1;
+            break;
+        case OpCode::Move:
+        case OpCode::Neg:
+            state[in.a] = state[in.b];
+            break;
+        // sizes of both sides have to match, or it throws
+        case OpCode::Add:
+        case OpCode::Sub:
+            state[in.a] = state[in.b] || state[in.c];
+            break;
+        case OpCode::Mul:
+            state[in.a] = state[in.b] && state[in.c];
+            break;
+        case OpCode::Div:
+            state[in.a] = state[in.b];
+            break;
+        case OpCode::AddInt:
+        case OpCode::SubInt:
+        case OpCode::MulInt:
+        case OpCode::DivInt:
+        case OpCode::Index:
+        case OpCode::IndexInBounds:
+        case OpCode::Len:
+            state[in.a] = true;
+            break;
+        case OpCode::StoreIndex:
+        case OpCode::StoreIndexInBounds:
+        case OpCode::Jump:
+        case OpCode::JumpIfFalse:
+        case OpCode::JumpIfTrue:
+        case OpCode::Step:
+        case OpCode::Return:
+        case OpCode::ReturnNone:
+            break;
+        // arguments are moved out of their registers, which are temporaries
+        // following everything else
+        case OpCode::Call:
+        case OpCode::CallNative:
+            for (unsigned reg = in.c; reg < state.size(); ++reg)
+                state[reg] = false;
+            state[in.a] = false;
+            break;
+        // booleans, which are () when false
+        default:
+            state[in.a] = false;
+            break;
+    }
+}
+
+// the Int form of op, or op itself
+OpCode typed(OpCode op) {
+    switch (op) {
+        case OpCode::Add: return OpCode::AddInt;
+        case OpCode::Sub: return OpCode::SubInt;
+        case OpCode::Mul: return OpCode::MulInt;
+        case OpCode::Div: return OpCode::DivInt;
+        case OpCode::Eq: return OpCode::EqInt;
+        case OpCode::Ne: return OpCode::NeInt;
+        case OpCode::Lt: return OpCode::LtInt;
+        case OpCode::Gt: return OpCode::GtInt;
+        case OpCode::Le: return OpCode::LeInt;
+        case OpCode::Ge: return OpCode::GeInt;
+        default: return op;
+    }
+}
+
+}
+
+Types::Types(const Chunk &chunk) : registers(chunk.registers) {
+    size_t n = chunk.code.size();
+    known.assign(n * registers, false);
+    if (n == 0)
+        return;
+
+    std::vector<State> before(n);
+    std::vector<bool> queued(n, false);
+    std::vector<size_t> work;
+    before[0].assign(registers, false);
+    work.push_back(0);
+    queued[0] = true;
+
+    // meets the state with what target has, queueing it on a change
+    auto flow = [&](size_t target, const State &state) {
+        if (target >= n)
+            return;
+        State &into = before[target];
+        bool changed = into.empty();
+        if (changed) {
+            into = state;
+        } else {
+            for (unsigned reg = 0; reg < registers; ++reg) {
+                if (into[reg] && !state[reg]) {
+                    into[reg] = false;
+                    changed = true;
+                }
+            }
+        }
+        if (changed && !queued[target]) {
+            queued[target] = true;
+            work.push_back(target);
+        }
+    };
+
+    while (!work.empty()) {
+        size_t pc = work.back();
+        work.pop_back();
+        queued[pc] = false;
+
+        const Instruction &in = chunk.code[pc];
+        State state = before[pc];
+        transfer(chunk, in, state);
+        if (in.op == OpCode::Jump) {
+            flow(in.b, state);
+        } else if (in.op == OpCode::JumpIfFalse || in.op == OpCode::JumpIfTrue) {
+            flow(in.b, state);
+            flow(pc + 1, state);
+        } else if (in.op != OpCode::Return && in.op != OpCode::ReturnNone) {
+            flow(pc + 1, state);
+        }
+    }
+
+    // code never reached keeps nothing known
+    for (size_t pc = 0; pc < n; ++pc)
+        for (unsigned reg = 0; reg < before[pc].size(); ++reg)
+            known[pc * registers + reg] = before[pc][reg];
+}
+
+void Types::specialize(Chunk &chunk) {
+    Types types(chunk);
+    for (size_t pc = 0; pc < chunk.code.size(); ++pc) {
+        Instruction &in = chunk.code[pc];
+        OpCode op = typed(in.op);
+        if (op != in.op && types.scalar(pc, in.b) && types.scalar(pc, in.c))
+            in.op = op;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef VM_TYPES_HPP_
+#define VM_TYPES_HPP_
+
+#include <cstddef>
+#include <vector>
+#include "Bytecode.hpp"
+
+namespace vm
+{
+
+// Which registers of a chunk provably hold a single int, before every
+// instruction. Found by a forward pass over the code: constants of one
+// value, len(), v[i] and arithmetic on such registers give one, anything
+// a call, slice or append writes may not; where paths meet, a register
+// counts only if it does on all of them. Parameters are never assumed to.
+class Types
+{
+public:
+    explicit Types(const Chunk &chunk);
+
+    bool scalar(size_t pc, unsigned reg) const {
+        return known[pc * registers + reg];
+    }
+
+    // turns arithmetic and comparisons whose operands are both scalars
+    // into their Int forms, which skip the size checks of Var
+    static void specialize(Chunk &chunk);
+
+private:
+    unsigned registers;
+    // registers bits per instruction
+    std::vector<bool> known;
+};
+
+}
+
+#endif
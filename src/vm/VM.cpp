@@ -0,0 +1,317 @@
+#include "VM.hpp"
+
+#include <memory>
+#include <stdexcept>
+#include "../ast/Error.hpp"
+
+using namespace vm;
+using namespace ast;
+
+namespace
+{
+
+int first(const Var &var) {
+    if (var.value.empty())
+        throw std::runtime_error("Index out of range");
+    return var.value[0];
+}
+
+// operand of the Int ops, known to hold a single value
+possibleValue scalar(const Var &var) {
+    return var.value[0];
+}
+
+// arithmetic wraps around, like the kernels of Var do
+possibleValue wrap(unsigned val) {
+    return static_cast<possibleValue>(val);
+}
+
+void setInt(Var &reg, VarType type, possibleValue val) {
+    reg.type = type;
+    reg.value.assign(val);
+}
+
+// Var::boolean, without building a new Var
+void setBool(Var &reg, bool val) {
+    if (val) {
+        setInt(reg, VarType::INT, 1);
+    } else {
+        reg.type = VarType::UNDEFINED;
+        reg.value.clear();
+    }
+}
+
+}
+
+Var VM::run(const Module &module, std::vector<Var> args) {
+    const Chunk *entry = &module.chunks.at(module.entry);
+    if (args.size() != entry->params)
+        throw std::runtime_error("Wrong number of parameters in functionCall");
+
+    stack.clear();
+    frames.clear();
+    stack.resize(entry->registers);
+    for (unsigned i = 0; i < args.size(); ++i)
+        stack[i] = std::move(args[i]);
+    frames.push_back(CallFrame{entry, 0, 0, 0, Stats::enter(entry->name)});
+    budget.start();
+    bool useJit = jit && !budget.limited();
+
+    CallFrame *frame = &frames.back();
+    const Instruction *code = frame->chunk->code.data();
+    Var *regs = stack.data();
+    size_t pc = 0;
+
+    // pops the current frame, handing value to the caller; true when it
+    // was the last one
+    auto leave = [&](Var &value) {
+        size_t base = frame->base;
+        unsigned dst = frame->dst;
+        Stats::leave(frame->counted);
+
+        frames.pop_back();
+        stack.resize(base);
+        if (frames.empty())
+            return true;
+
+        frame = &frames.back();
+        code = frame->chunk->code.data();
+        regs = stack.data() + frame->base;
+        pc = frame->pc;
+        regs[dst] = std::move(value);
+        return false;
+    };
+
+    std::unique_ptr<Jit> native;
+    std::vector<unsigned> calls(module.chunks.size()), loops(module.chunks.size()), failures(module.chunks.size());
+    auto hot = [&](std::vector<unsigned> &counts, unsigned chunk, unsigned threshold) -> const Jit* {
+        if (failures[chunk] >= Jit::maxFailures)
+            return nullptr;
+        if (counts[chunk] < threshold) {
+            ++counts[chunk];
+            return nullptr;
+        }
+        if (!native)
+            native = Jit::compile(module);
+        return native->compiled(chunk) ? native.get() : nullptr;
+    };
+
+    try {
+        while (true) {
+            const Instruction &in = code[pc++];
+
+            switch (in.op) {
+                case OpCode::LoadConst: {
+                    // scalars are written into the register's own storage
+                    const Var &constant = frame->chunk->constants[in.b];
+                    if (constant.value.size() == 1)
+                        setInt(regs[in.a], constant.type, scalar(constant));
+                    else
+                        regs[in.a] = constant;
+                    break;
+                }
+                case OpCode::Move:
+                    regs[in.a] = regs[in.b]; break;
+                case OpCode::Neg:
+                    if (in.a == in.b) regs[in.a].negate();
+                    else regs[in.a] = -regs[in.b];
+                    break;
+                case OpCode::Not:
+                    regs[in.a] = !regs[in.b]; break;
+                case OpCode::Add:
+                    if (in.a == in.b) regs[in.a] += regs[in.c];
+                    else regs[in.a] = regs[in.b] + regs[in.c];
+                    break;
+                case OpCode::Sub:
+                    if (in.a == in.b) regs[in.a] -= regs[in.c];
+                    else regs[in.a] = regs[in.b] - regs[in.c];
+                    break;
+                case OpCode::Mul:
+                    if (in.a == in.b) regs[in.a] *= regs[in.c];
+                    else regs[in.a] = regs[in.b] * regs[in.c];
+                    break;
+                case OpCode::Div:
+                    if (in.a == in.b) regs[in.a] /= regs[in.c];
+                    else regs[in.a] = regs[in.b] / regs[in.c];
+                    break;
+                case OpCode::Eq:
+                    regs[in.a] = regs[in.b] == regs[in.c]; break;
+                case OpCode::Ne:
+                    regs[in.a] = regs[in.b] != regs[in.c]; break;
+                case OpCode::Lt:
+                    regs[in.a] = regs[in.b] < regs[in.c]; break;
+                case OpCode::Gt:
+                    regs[in.a] = regs[in.b] > regs[in.c]; break;
+                case OpCode::Le:
+                    regs[in.a] = regs[in.b] <= regs[in.c]; break;
+                case OpCode::Ge:
+                    regs[in.a] = regs[in.b] >= regs[in.c]; break;
+                case OpCode::And:
+                    regs[in.a] = regs[in.b] && regs[in.c]; break;
+                case OpCode::Or:
+                    regs[in.a] = regs[in.b] || regs[in.c]; break;
+
+                // results take the type Var's operators would give them
+                case OpCode::AddInt:
+                    setInt(regs[in.a], regs[in.b].type, wrap(static_cast<unsigned>(scalar(regs[in.b])) + static_cast<unsigned>(scalar(regs[in.c]))));
+                    break;
+                case OpCode::SubInt:
+                    setInt(regs[in.a], regs[in.b].type, wrap(static_cast<unsigned>(scalar(regs[in.b])) - static_cast<unsigned>(scalar(regs[in.c]))));
+                    break;
+                case OpCode::MulInt:
+                    setInt(regs[in.a], regs[in.c].type, wrap(static_cast<unsigned>(scalar(regs[in.b])) * static_cast<unsigned>(scalar(regs[in.c]))));
+                    break;
+                case OpCode::DivInt: {
+                    possibleValue divisor = scalar(regs[in.c]);
+                    if (!divisor)
+                        throw std::runtime_error("Cannot divide by 0");
+                    possibleValue dividend = scalar(regs[in.b]);
+                    setInt(regs[in.a], regs[in.b].type, divisor == -1 ? wrap(0u - static_cast<unsigned>(dividend)) : dividend / divisor);
+                    break;
+                }
+                case OpCode::EqInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) == scalar(regs[in.c])); break;
+                case OpCode::NeInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) != scalar(regs[in.c])); break;
+                case OpCode::LtInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) < scalar(regs[in.c])); break;
+                case OpCode::GtInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) > scalar(regs[in.c])); break;
+                case OpCode::LeInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) <= scalar(regs[in.c])); break;
+                case OpCode::GeInt:
+                    setBool(regs[in.a], scalar(regs[in.b]) >= scalar(regs[in.c])); break;
+
+                case OpCode::Index: {
+                    int idx = first(regs[in.c]);
+                    const Var &vector = regs[in.b];
+                    regs[in.a] = Var(VarType::INT, valueVec({vector.at(static_cast<unsigned int>(idx))}));
+                    break;
+                }
+                case OpCode::Slice: {
+                    int idx1 = first(regs[in.c]);
+                    int idx2 = first(regs[in.c + 1]);
+                    regs[in.a] = regs[in.b].slice(idx1, idx2);
+                    break;
+                }
+                case OpCode::StoreIndex: {
+                    int idx = first(regs[in.b]);
+                    if (idx >= 0) {
+                        const Var &value = regs[in.c];
+                        if (value.value.size() == 1)
+                            regs[in.a].at(static_cast<unsigned int>(idx)) = value.at(0);
+                        else
+                            throw std::runtime_error("Cannot assign vector to int");
+                    }
+                    break;
+                }
+                case OpCode::IndexInBounds: {
+                    const Var &vector = regs[in.b];
+                    setInt(regs[in.a], VarType::INT, vector.value[scalar(regs[in.c])]);
+                    break;
+                }
+                case OpCode::StoreIndexInBounds: {
+                    const Var &value = regs[in.c];
+                    if (value.value.size() != 1)
+                        throw std::runtime_error("Cannot assign vector to int");
+                    possibleValue stored = scalar(value);
+                    regs[in.a].value[scalar(regs[in.b])] = stored;
+                    break;
+                }
+                case OpCode::Len: {
+                    int size = regs[in.b].value.size();
+                    regs[in.a] = Var(VarType::INT, valueVec({size}));
+                    break;
+                }
+                case OpCode::Append: {
+                    const valueVec &from = regs[in.b].value;
+                    regs[in.a].value.append(from.begin(), from.end());
+                    break;
+                }
+
+                case OpCode::Step:
+                    budget.step();
+                    break;
+                case OpCode::Jump:
+                    if (in.b < pc)
+                        budget.step();
+                    if (useJit && in.b < pc) {
+                        unsigned chunk = frame->chunk - module.chunks.data();
+                        if (const Jit *compiled = hot(loops, chunk, Jit::hotLoops)) {
+                            Var value;
+                            if (compiled->resume(chunk, in.b, regs, value)) {
+                                if (leave(value))
+                                    return value;
+                                break;
+                            }
+                            loops[chunk] = 0;
+                            ++failures[chunk];
+                        }
+                    }
+                    pc = in.b;
+                    break;
+                case OpCode::JumpIfFalse:
+                    if (!static_cast<bool>(regs[in.a])) pc = in.b;
+                    break;
+                case OpCode::JumpIfTrue:
+                    if (static_cast<bool>(regs[in.a])) pc = in.b;
+                    break;
+
+                case OpCode::Call: {
+                    if (useJit) {
+                        Var value;
+                        if (const Jit *compiled = hot(calls, in.b, Jit::hotCalls)) {
+                            if (compiled->call(in.b, regs + in.c, value)) {
+                                regs[in.a] = std::move(value);
+                                break;
+                            }
+                            ++failures[in.b];
+                        }
+                    }
+                    budget.step();
+                    const Chunk &callee = module.chunks[in.b];
+                    size_t base = frame->base + frame->chunk->registers;
+                    frame->pc = pc;
+
+                    stack.resize(base + callee.registers);
+                    regs = stack.data() + frame->base;
+                    for (unsigned i = 0; i < callee.params; ++i)
+                        stack[base + i] = std::move(regs[in.c + i]);
+
+                    frames.push_back(CallFrame{&callee, 0, base, in.a, Stats::enter(callee.name)});
+                    frame = &frames.back();
+                    code = callee.code.data();
+                    regs = stack.data() + base;
+                    pc = 0;
+                    break;
+                }
+                case OpCode::CallNative: {
+                    const Builtin &builtin = *module.natives[in.b];
+                    if (builtin.blocking)
+                        budget.pause();
+                    Stats::Scope stats(builtin.name);
+                    regs[in.a] = builtin.native(regs + in.c);
+                    break;
+                }
+                case OpCode::Return:
+                case OpCode::ReturnNone: {
+                    Var value = in.op == OpCode::Return ? std::move(regs[in.a]) : Var();
+                    if (leave(value))
+                        return value;
+                    break;
+                }
+            }
+        }
+    } catch (std::runtime_error &) {
+        // frames left by the error don't hand counting back, so it goes
+        // straight to where it was before the run
+        Stats::leave(frames.front().counted);
+        // pc is already past the instruction that failed
+        const Chunk &chunk = *frame->chunk;
+        Position at = pc - 1 < chunk.positions.size() ? chunk.positions[pc - 1] : Position{0, 0};
+        RuntimeError::rethrow(at.line, module.chunks.at(at.chunk).name);
+    } catch (...) {
+        Stats::leave(frames.front().counted);
+        throw;
+    }
+}
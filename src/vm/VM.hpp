@@ -0,0 +1,46 @@
+#ifndef VM_VM_HPP_
+#define VM_VM_HPP_
+
+#include <vector>
+#include "Bytecode.hpp"
+#include "Jit.hpp"
+#include "../ast/Budget.hpp"
+
+namespace vm
+{
+
+// Register machine executing a compiled Module. Every call gets its own
+// window of registers on a shared stack, so recursion doesn't clobber
+// the caller's variables.
+class VM
+{
+public:
+    ast::Var run(const Module &module, std::vector<ast::Var> args = std::vector<ast::Var>());
+
+    // hot chunks run as native code: calls to them, and their loops from
+    // the iteration they got hot in
+    void enableJit(bool enable) { jit = enable; }
+
+    // limits of every following run, see ast::Budget; loops and calls are
+    // its steps
+    void setBudget(const ast::Budget &budget_) { budget = budget_; }
+
+private:
+    struct CallFrame {
+        const Chunk* chunk;
+        size_t pc;
+        size_t base;
+        unsigned dst;
+        // what Stats counted into before the call
+        ast::Stats::Counters *counted;
+    };
+
+    std::vector<ast::Var> stack;
+    std::vector<CallFrame> frames;
+    bool jit = false;
+    ast::Budget budget;
+};
+
+}
+
+#endif
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Checks the scripts here against what they're expected to print: X.scr
+# against X.out in every backend, and edit sequences for --watch, X_1.scr,
+# X_2.scr, ... saved one after another over the same file, against X.out
+# holding a line per step. Each runs in a directory of its own, removed
+# afterwards, so files the scripts save don't stay behind.
+#
+# test_files/run.sh [path to scr, ./scr by default]
+
+scr=$(realpath "${1:-./scr}")
+here=$(dirname "$(realpath "$0")")
+failed=0
+
+fail() {
+    echo "FAIL $1: expected $2, got $3"
+    failed=1
+}
+
+for script in "$here"/*.scr; do
+    name=$(basename "$script" .scr)
+    [ -f "$here/$name.out" ] || continue
+    expected=$(cat "$here/$name.out")
+    for mode in "" --tree --no-opt --jit --lazy; do
+        dir=$(mktemp -d)
+        got=$(cd "$dir" && "$scr" $mode "$script" 2>&1)
+        rm -rf "$dir"
+        [ "$got" = "$expected" ] || fail "$name $mode" "$expected" "$got"
+    done
+done
+
+for first in "$here"/*_1.scr; do
+    [ -f "$first" ] || continue
+    name=$(basename "$first" _1.scr)
+    dir=$(mktemp -d)
+    cp "$first" "$dir/watched.scr"
+    (cd "$dir" && exec "$scr" --watch watched.scr > out 2> /dev/null) &
+    watcher=$!
+    step=1
+    while true; do
+        # a run at a time, each saved with a later time than the last
+        tries=0
+        while [ "$(wc -l < "$dir/out")" -lt $step ] && [ $tries -lt 50 ]; do
+            sleep 0.1
+            tries=$((tries + 1))
+        done
+        step=$((step + 1))
+        [ -f "$here/${name}_$step.scr" ] || break
+        cp "$here/${name}_$step.scr" "$dir/watched.scr"
+        touch -d "@$(($(date +%s) + step))" "$dir/watched.scr"
+    done
+    kill $watcher
+    wait $watcher 2> /dev/null
+    expected=$(cat "$here/$name.out")
+    got=$(cat "$dir/out")
+    rm -rf "$dir"
+    [ "$got" = "$expected" ] || fail "$name --watch" "$expected" "$got"
+done
+
+[ $failed = 0 ] && echo "all passed"
+exit $failed